@@ -0,0 +1,196 @@
+
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Edward.Wu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "SLSRoleTable.hpp"
+
+/*
+ * cost of one poll of a worker with 1k to 16k sockets, the events handed to
+ * the roles through the role table against the std::map lookups per list
+ * which the worker did before.
+ * a part of the roles is ready in each poll, a few broken sockets are
+ * reported both writable and readable.
+ * usage: sls_bench_dispatch [polls of each run]
+ */
+
+const int BENCH_EVENT_OUT = 1;
+const int BENCH_EVENT_IN = 2;
+const int BENCH_BROKEN_PERCENT = 1; //of the ready sockets
+
+struct SLSBenchPoll
+{
+    std::vector<int> write_socks;
+    std::vector<int> read_socks;
+};
+
+uint64_t g_handled = 0; //mixed from the roles handled, the work can't be dropped
+
+static void bench_handle(CSLSRole *role, int events)
+{
+    g_handled = g_handled * 31 + (uintptr_t)role + events;
+}
+
+//the worker before: each list looked up in the map, a broken socket handled twice.
+static int64_t bench_map(std::map<int, CSLSRole *> &map_role, const SLSBenchPoll &poll)
+{
+    int64_t count = 0;
+    for (int fd : poll.write_socks)
+    {
+        std::map<int, CSLSRole *>::iterator it = map_role.find(fd);
+        if (it == map_role.end())
+            continue;
+        bench_handle(it->second, BENCH_EVENT_OUT);
+        count++;
+    }
+    for (int fd : poll.read_socks)
+    {
+        std::map<int, CSLSRole *>::iterator it = map_role.find(fd);
+        if (it == map_role.end())
+            continue;
+        bench_handle(it->second, BENCH_EVENT_IN);
+        count++;
+    }
+    return count;
+}
+
+//the worker now: the events of a role combined in its entry by the role table, one dispatch per role.
+static int64_t bench_table(CSLSRoleTable &roles, std::vector<int> &event_roles, const SLSBenchPoll &poll)
+{
+    roles.merge_events(poll.write_socks.data(), poll.write_socks.size(),
+                       poll.read_socks.data(), poll.read_socks.size(), event_roles);
+    for (int index : event_roles)
+    {
+        SLSRoleEntry &entry = roles.at(index);
+        int events = entry.events;
+        entry.events = 0;
+        bench_handle(entry.role, events);
+    }
+    return event_roles.size();
+}
+
+static bool bench_run(int role_count, int ready_percent, int poll_count)
+{
+    std::mt19937 rand(role_count + ready_percent);
+
+    //srt socket ids count down from a random start
+    std::vector<int> fds;
+    int fd = (1 << 30) - (int)(rand() % 1000000);
+    for (int i = 0; i < role_count; i++)
+    {
+        fds.push_back(fd--);
+    }
+    std::map<int, CSLSRole *> map_role;
+    CSLSRoleTable roles;
+    for (int i = 0; i < role_count; i++)
+    {
+        CSLSRole *role = (CSLSRole *)(uintptr_t)((i + 1) * 64);
+        map_role[fds[i]] = role;
+        roles.insert(fds[i], role);
+    }
+
+    //players are writable, publishers readable
+    const int poll_kinds = 16;
+    std::vector<SLSBenchPoll> polls(poll_kinds);
+    for (SLSBenchPoll &poll : polls)
+    {
+        std::shuffle(fds.begin(), fds.end(), rand);
+        int ready = std::max(1, role_count * ready_percent / 100);
+        for (int i = 0; i < ready; i++)
+        {
+            if (i % 10 == 0)
+                poll.read_socks.push_back(fds[i]);
+            else
+                poll.write_socks.push_back(fds[i]);
+            if ((int)(rand() % 100) < BENCH_BROKEN_PERCENT)
+            {
+                poll.read_socks.push_back(fds[i]);
+                poll.write_socks.push_back(fds[i]);
+            }
+        }
+    }
+
+    std::vector<int> event_roles;
+    int64_t map_count = 0;
+    int64_t table_count = 0;
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < poll_count; i++)
+    {
+        map_count += bench_map(map_role, polls[i % poll_kinds]);
+    }
+    std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+    for (int i = 0; i < poll_count; i++)
+    {
+        table_count += bench_table(roles, event_roles, polls[i % poll_kinds]);
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    //each ready role is handled once, the map handles a broken one twice
+    int64_t expected_count = 0;
+    int64_t both_count = 0;
+    for (int i = 0; i < poll_count; i++)
+    {
+        SLSBenchPoll &poll = polls[i % poll_kinds];
+        std::vector<int> socks(poll.write_socks);
+        socks.insert(socks.end(), poll.read_socks.begin(), poll.read_socks.end());
+        std::sort(socks.begin(), socks.end());
+        int64_t unique = std::unique(socks.begin(), socks.end()) - socks.begin();
+        expected_count += unique;
+        both_count += socks.size() - unique;
+    }
+    bool ok = table_count == expected_count && map_count == expected_count + both_count;
+
+    double map_ns = std::chrono::duration<double, std::nano>(middle - begin).count() / poll_count;
+    double table_ns = std::chrono::duration<double, std::nano>(end - middle).count() / poll_count;
+    printf("%7d %6d%% %14.0f %14.0f %7.2fx %s\n", role_count, ready_percent,
+           map_ns, table_ns, map_ns / table_ns, ok ? "ok" : "WRONG DISPATCH");
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    int poll_count = argc > 1 ? atoi(argv[1]) : 2000;
+    if (poll_count <= 0)
+        poll_count = 2000;
+
+    printf("%7s %7s %14s %14s %8s\n", "sockets", "ready", "map ns/poll", "table ns/poll", "speedup");
+    bool ok = true;
+    const int role_counts[] = {1000, 4000, 16000};
+    const int ready_percents[] = {10, 100};
+    for (int role_count : role_counts)
+    {
+        for (int ready_percent : ready_percents)
+        {
+            ok = bench_run(role_count, ready_percent, poll_count) && ok;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,188 @@
+
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Edward.Wu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SLSLock.hpp"
+#include "SLSShardedMap.hpp"
+
+/*
+ * scaling of the stream registry with 10k streams, the sharded map against
+ * one std::map behind one rwlock as the registries were before.
+ * 1, 4 or 16 threads look up streams and replace some publishers, like
+ * the workers do when players join and publishers reconnect.
+ * usage: sls_bench_registry [duration of each run in ms]
+ */
+
+const int BENCH_STREAM_COUNT = 10000;
+const int BENCH_WRITE_PERCENT = 5; //of the operations, an erase and an insert
+
+/**
+ * CSLSLockedMap, the registry before the sharding.
+ */
+template <typename K, typename V>
+class CSLSLockedMap
+{
+public:
+    void set(const K &key, const V &value)
+    {
+        CSLSLock lock(&m_rwclock, true);
+        m_map[key] = value;
+    }
+
+    bool find(const K &key, V &value)
+    {
+        CSLSLock lock(&m_rwclock, false);
+        typename std::map<K, V>::iterator it = m_map.find(key);
+        if (it == m_map.end())
+            return false;
+        value = it->second;
+        return true;
+    }
+
+    bool erase(const K &key)
+    {
+        CSLSLock lock(&m_rwclock, true);
+        return m_map.erase(key) > 0;
+    }
+
+    std::map<K, V> items()
+    {
+        CSLSLock lock(&m_rwclock, false);
+        return m_map;
+    }
+
+private:
+    CSLSRWLock m_rwclock;
+    std::map<K, V> m_map;
+};
+
+static std::vector<std::string> g_keys;
+
+//the same operations on any registry, return the found streams.
+template <typename M>
+static int64_t bench_ops(M *registry, unsigned int seed, int64_t count, std::atomic<bool> *stop, int64_t *ops)
+{
+    std::mt19937 rand(seed);
+    int64_t found = 0;
+    int64_t value = 0;
+    int64_t i = 0;
+    for (; i < count && !(stop && stop->load(std::memory_order_relaxed)); i++)
+    {
+        const std::string &key = g_keys[rand() % g_keys.size()];
+        if ((int)(rand() % 100) < BENCH_WRITE_PERCENT)
+        {
+            registry->erase(key);
+            registry->set(key, (int64_t)i);
+        }
+        else if (registry->find(key, value))
+        {
+            found++;
+        }
+    }
+    if (ops)
+        *ops = i;
+    return found;
+}
+
+template <typename M>
+static double bench_run(M *registry, int thread_count, int duration_ms)
+{
+    std::atomic<bool> stop(false);
+    std::vector<int64_t> ops(thread_count, 0);
+    std::vector<std::thread> threads;
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < thread_count; i++)
+    {
+        threads.push_back(std::thread(bench_ops<M>, registry, i + 1, INT64_MAX, &stop, &ops[i]));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+    stop = true;
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    int64_t total = 0;
+    for (int64_t n : ops)
+    {
+        total += n;
+    }
+    return total / seconds;
+}
+
+//both registries end up with the same streams after the same operations.
+static bool bench_check()
+{
+    CSLSShardedMap<std::string, int64_t> sharded;
+    CSLSLockedMap<std::string, int64_t> locked;
+    bench_ops(&sharded, 7, 100000, NULL, NULL);
+    bench_ops(&locked, 7, 100000, NULL, NULL);
+    std::map<std::string, int64_t> items;
+    sharded.clear(&items);
+    return items == locked.items();
+}
+
+int main(int argc, char *argv[])
+{
+    int duration_ms = argc > 1 ? atoi(argv[1]) : 2000;
+    if (duration_ms <= 0)
+        duration_ms = 2000;
+
+    for (int i = 0; i < BENCH_STREAM_COUNT; i++)
+    {
+        g_keys.push_back("uplive.sls.com/live/stream" + std::to_string(i));
+    }
+    if (!bench_check())
+    {
+        printf("the sharded registry doesn't match the locked one.\n");
+        return 1;
+    }
+
+    printf("%-8s %7s %14s %14s %8s\n", "streams", "threads", "locked ops/s", "sharded ops/s", "speedup");
+    const int thread_counts[] = {1, 4, 16};
+    for (int thread_count : thread_counts)
+    {
+        CSLSShardedMap<std::string, int64_t> sharded;
+        CSLSLockedMap<std::string, int64_t> locked;
+        for (int i = 0; i < BENCH_STREAM_COUNT; i++)
+        {
+            sharded.set(g_keys[i], i);
+            locked.set(g_keys[i], i);
+        }
+        double locked_ops = bench_run(&locked, thread_count, duration_ms);
+        double sharded_ops = bench_run(&sharded, thread_count, duration_ms);
+        printf("%-8d %7d %14.0f %14.0f %7.2fx\n", BENCH_STREAM_COUNT, thread_count,
+               locked_ops, sharded_ops, sharded_ops / locked_ops);
+    }
+    return 0;
+}
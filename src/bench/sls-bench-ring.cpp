@@ -0,0 +1,159 @@
+
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Edward.Wu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "spdlog/spdlog.h"
+
+#include "SLSRecycleArray.hpp"
+
+/*
+ * contention of the stream ring, one publisher and 1, 4 or 16 players,
+ * with the rwlock and in lock free mode.
+ * the publisher puts numbered packets as fast as it can, each player
+ * checks that the packets it gets never go back.
+ * usage: sls_bench_ring [duration of each run in ms]
+ */
+
+const int BENCH_PACKET_LEN = TS_UDP_LEN;
+const int BENCH_VIEW_COUNT = 8;
+const int BENCH_KEYFRAME_INTERVAL = 256; //packets
+
+struct SLSBenchReader
+{
+    int64_t gets;
+    int64_t bytes;
+    int64_t overruns;
+    bool ok;
+};
+
+static void bench_reader(CSLSRecycleArray *ring, std::atomic<bool> *stop, SLSBenchReader *result)
+{
+    SLSRecycleArrayID read_id;
+    memset(&read_id, 0, sizeof(read_id));
+    read_id.bFirst = true;
+    SLSChunkView views[BENCH_VIEW_COUNT];
+    int64_t last_seq = -1;
+
+    while (!stop->load(std::memory_order_relaxed))
+    {
+        int view_count = BENCH_VIEW_COUNT;
+        int ret = ring->get(views, view_count, &read_id, BENCH_PACKET_LEN);
+        if (ret <= 0)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        result->gets++;
+        result->bytes += ret;
+        for (int i = 0; i < view_count; i++)
+        {
+            for (int pos = 0; pos + BENCH_PACKET_LEN <= views[i].len; pos += BENCH_PACKET_LEN)
+            {
+                int64_t seq;
+                memcpy(&seq, views[i].chunk->data + views[i].offset + pos, sizeof(seq));
+                if (seq <= last_seq)
+                    result->ok = false;
+                last_seq = seq;
+            }
+        }
+        CSLSRecycleArray::release_views(views, view_count);
+    }
+    result->overruns = read_id.nOverrun;
+}
+
+static bool bench_run(bool lock_free, int reader_count, int duration_ms)
+{
+    CSLSRecycleArray ring;
+    ring.set_lock_free(lock_free);
+    std::atomic<bool> stop(false);
+    std::vector<SLSBenchReader> results(reader_count, SLSBenchReader{0, 0, 0, true});
+    std::vector<std::thread> readers;
+    for (int i = 0; i < reader_count; i++)
+    {
+        readers.push_back(std::thread(bench_reader, &ring, &stop, &results[i]));
+    }
+
+    char packet[BENCH_PACKET_LEN] = {0};
+    int64_t seq = 0;
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point end = begin + std::chrono::milliseconds(duration_ms);
+    while (std::chrono::steady_clock::now() < end)
+    {
+        for (int i = 0; i < BENCH_KEYFRAME_INTERVAL; i++, seq++)
+        {
+            memcpy(packet, &seq, sizeof(seq));
+            ring.put(packet, BENCH_PACKET_LEN, i == 0 ? 0 : -1);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    stop = true;
+    for (std::thread &reader : readers)
+    {
+        reader.join();
+    }
+
+    bool ok = true;
+    int64_t gets = 0;
+    int64_t bytes = 0;
+    int64_t overruns = 0;
+    for (SLSBenchReader &result : results)
+    {
+        ok = ok && result.ok;
+        gets += result.gets;
+        bytes += result.bytes;
+        overruns += result.overruns;
+    }
+    printf("%-9s %7d %12.0f %12.0f %12.1f %10lld %s\n",
+           lock_free ? "lock_free" : "rwlock", reader_count,
+           seq / seconds, gets / seconds, bytes / seconds / reader_count / 1000000,
+           (long long)overruns, ok ? "ok" : "OUT OF ORDER");
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    int duration_ms = argc > 1 ? atoi(argv[1]) : 2000;
+    if (duration_ms <= 0)
+        duration_ms = 2000;
+    //the lapped readers would log each overrun
+    spdlog::set_level(spdlog::level::err);
+
+    printf("%-9s %7s %12s %12s %12s %10s\n", "mode", "readers", "puts/s", "gets/s", "MB/s/reader", "overruns");
+    bool ok = true;
+    const int reader_counts[] = {1, 4, 16};
+    for (bool lock_free : {false, true})
+    {
+        for (int reader_count : reader_counts)
+        {
+            ok = bench_run(lock_free, reader_count, duration_ms) && ok;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -22,14 +22,28 @@
  * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
 #include <errno.h>
+#include <sched.h>
 #include <string.h>
+#include <tuple>
 #include "spdlog/spdlog.h"
 
 #include "SLSGroup.hpp"
 #include "SLSLog.hpp"
+#include "SLSPlayer.hpp"
+#include "SLSRingArena.hpp"
 
 #define POLLING_TIME 100 /// Time in milliseconds between interrupt check
+#define ROLE_CHECK_TIME 1000 /// ms between the checks of a role
+#define RELAY_CHECK_TIME 1000 /// ms between the reconnect tries of a relay
+
+enum
+{
+    GROUP_TIMER_ROLE = 0,
+    GROUP_TIMER_RELAY,
+    GROUP_TIMER_STAT,
+};
 
 /**
  * CSLSGroup class implementation
@@ -41,18 +55,29 @@ CSLSGroup::CSLSGroup()
     m_worker_connections = 100;
     m_worker_number = 0;
     m_reload = false;
+    m_cur_time_microsec = 0;
+    m_spin_time = 0;
+    m_cpu_node = -1;
+    m_last_active_tm = 0;
+    m_load_begin_tm = 0;
+    m_load_wait_time = 0;
+    m_load_bytes = 0;
+    m_loop_begin_tm = 0;
+    m_loop_time = 0;
+    m_loop_max_time = 0;
+    m_loop_count = 0;
+    m_overload_loop_time = 0;
+    m_overload_bytes = 0;
+    m_overload_shed = 0;
+    m_overload_count = 0;
 
-    m_stat_post_last_tm_ms = sls_gettime_ms();
     m_stat_post_interval = 5; // 5s default
 }
 CSLSGroup::~CSLSGroup()
 {
+    //the role list is shared by the groups and released by the manager.
     spdlog::trace("[{}] CSLSGroup::~CSLSGroup(), role={}", fmt::ptr(this), fmt::ptr(m_list_role));
-    if (m_list_role)
-    {
-        delete m_list_role;
-        m_list_role = NULL;
-    }
+    m_list_role = NULL;
 }
 
 int CSLSGroup::start()
@@ -62,6 +87,19 @@ int CSLSGroup::start()
     return CSLSEpollThread::start();
 }
 
+//runs on the pinned cpus already, the rings written by this worker are allocated on their node.
+int CSLSGroup::work()
+{
+    if (!m_cpus.empty())
+    {
+        m_cpu_node = sls_get_cpu_node(sched_getcpu());
+        CSLSRingArena::set_thread_node(m_cpu_node);
+        spdlog::info("[{}] CSLSGroup::work, worker_number={:d}, cpu={:d}, node={:d}.",
+                     fmt::ptr(this), m_worker_number, sched_getcpu(), m_cpu_node);
+    }
+    return CSLSEpollThread::work();
+}
+
 int CSLSGroup::stop()
 {
     int ret = 0;
@@ -84,24 +122,74 @@ int CSLSGroup::stop()
     return ret;
 }
 
+//the ready queue is polled with the srt sockets, so a publisher of any worker
+//or a new role wakes this one.
+int CSLSGroup::init_epoll()
+{
+    int ret = CSLSEpollThread::init_epoll();
+    if (SLS_OK != ret)
+    {
+        return ret;
+    }
+    if (SLS_OK != m_ready_queue.open())
+    {
+        return SLS_ERROR;
+    }
+    int events = SRT_EPOLL_IN;
+    ret = srt_epoll_add_ssock(m_eid, m_ready_queue.get_fd(), &events);
+    if (ret < 0)
+    {
+        spdlog::error("[{}] CSLSGroup::init_epoll, srt_epoll_add_ssock failed, worker_number={:d}, fd={:d}.",
+                      fmt::ptr(this), m_worker_number, m_ready_queue.get_fd());
+        return CSLSSrt::libsrt_neterrno();
+    }
+    //the new roles placed on this worker interrupt the wait too.
+    if (m_list_role)
+    {
+        m_list_role->add_wake_queue(m_worker_number, &m_ready_queue);
+    }
+    m_timers.add(sls_gettime_ms() + m_stat_post_interval * 1000, GROUP_TIMER_STAT, 0);
+    return SLS_OK;
+}
+
+int CSLSGroup::uninit_epoll()
+{
+    if (m_ready_queue.get_fd() >= 0)
+    {
+        if (m_list_role)
+        {
+            m_list_role->remove_wake_queue(m_worker_number);
+        }
+        srt_epoll_remove_ssock(m_eid, m_ready_queue.get_fd());
+        m_ready_queue.close();
+    }
+    return CSLSEpollThread::uninit_epoll();
+}
+
 void CSLSGroup::reload()
 {
     m_reload = true;
 }
 
+//admit all the queued roles up to the worker connections.
 void CSLSGroup::check_new_role()
 {
 
     // first, check rolelist
     if (NULL == m_list_role)
         return;
-    if (m_map_role.size() >= m_worker_connections)
-        return;
 
-    CSLSRole *role = m_list_role->pop();
-    if (NULL == role)
-        return;
+    while ((unsigned int)m_roles.size() < m_worker_connections)
+    {
+        CSLSRole *role = m_list_role->pop(m_worker_number);
+        if (NULL == role)
+            return;
+        add_role(role);
+    }
+}
 
+void CSLSGroup::add_role(CSLSRole *role)
+{
     int fd = role->get_fd();
     if (fd == 0)
     {
@@ -113,9 +201,11 @@ void CSLSGroup::check_new_role()
     // add to epoll
     if (0 == role->add_to_epoll(m_eid))
     {
-        m_map_role[fd] = role;
+        m_roles.insert(fd, role);
+        schedule_role(m_roles.find_index(fd), sls_gettime_ms());
+        role->set_ready_queue(&m_ready_queue);
         spdlog::info("[{}] CSLSGroup::check_new_role, worker_number={:d}, {}={}, add_to_epoll fd={:d}, role_map.size={:d}.",
-                     fmt::ptr(this), m_worker_number, role->get_role_name(), fmt::ptr(role), fd, m_map_role.size());
+                     fmt::ptr(this), m_worker_number, role->get_role_name(), fmt::ptr(role), fd, m_roles.size());
     }
     else
     {
@@ -128,22 +218,27 @@ void CSLSGroup::check_new_role()
 int CSLSGroup::handler()
 {
     int ret = 0;
-    int i;
     int read_len = MAX_SOCK_COUNT;
     int write_len = MAX_SOCK_COUNT;
+    SYSSOCKET sys_socks[1];
+    int sys_len = 1;
 
     int handler_count = 0;
 
-    if (m_reload && (m_map_role.size() == 0))
+    if (m_reload && (m_roles.size() == 0))
     {
-        spdlog::info("[{}] CSLSGroup::handle, worker_number={:d} stop, m_reload is true, m_map_role.size()=0.",
+        spdlog::info("[{}] CSLSGroup::handle, worker_number={:d} stop, m_reload is true, m_roles.size()=0.",
                      fmt::ptr(this), m_worker_number);
         m_exit = true;
         return SLS_OK;
     }
 
-    // check epoll event
-    ret = srt_epoll_wait(m_eid, m_read_socks, &read_len, m_write_socks, &write_len, POLLING_TIME, 0, 0, 0, 0);
+    // check epoll event, a busy worker polls for the spin time before it blocks
+    m_cur_time_microsec = sls_gettime();
+    int timeout = m_cur_time_microsec - m_last_active_tm < m_spin_time ? 0 : POLLING_TIME;
+    ret = srt_epoll_wait(m_eid, m_read_socks, &read_len, m_write_socks, &write_len, timeout, sys_socks, &sys_len, 0, 0);
+    m_loop_begin_tm = sls_gettime();
+    m_load_wait_time += m_loop_begin_tm - m_cur_time_microsec;
     if (ret < 0)
     {
         // sls_log(SLS_LOG_TRACE, "[%p]CSLSGroup::handle, worker_number=%d, srt_epoll_wait, no epoll event, ret=%d.",
@@ -155,91 +250,275 @@ int CSLSGroup::handler()
             ret = CSLSSrt::libsrt_neterrno();
 
         idle_check();
+        end_loop();
         return handler_count;
     }
 
     spdlog::trace("[{}] CSLSGroup::handle, worker_number={:d}, writable sock count={:d}, readable sock count={:d}.",
                   fmt::ptr(this), m_worker_number, write_len, read_len);
 
-    for (i = 0; i < write_len; i++)
+    // combine the events of each role, a broken socket is reported in both lists
+    int unknown = m_roles.merge_events(m_write_socks, write_len, m_read_socks, read_len, m_event_roles);
+    if (unknown > 0)
     {
-        std::map<int, CSLSRole *>::iterator it = m_map_role.find(m_write_socks[i]);
-        if (it == m_map_role.end())
-        {
-            spdlog::warn("[{}] CSLSGroup::handle, worker_number={:d}, no role map writable sock={:d}, why?",
-                         fmt::ptr(this), m_worker_number, m_write_socks[i]);
-            continue;
-        }
+        spdlog::warn("[{}] CSLSGroup::handle, worker_number={:d}, no role map {:d} of the ready socks, why?",
+                     fmt::ptr(this), m_worker_number, unknown);
+    }
 
-        CSLSRole *role = it->second;
-        if (!role)
+    // one dispatch per role
+    for (int index : m_event_roles)
+    {
+        handler_count += dispatch(index);
+    }
+
+    // the writers signaled by the publishers, including the ones read above
+    handler_count += check_ready_roles();
+
+    m_load_bytes += handler_count;
+    idle_check();
+    end_loop();
+    if (handler_count > 0)
+    {
+        m_last_active_tm = sls_gettime();
+    }
+    return handler_count;
+}
+
+int CSLSGroup::dispatch(int index)
+{
+    SLSRoleEntry &entry = m_roles.at(index);
+    CSLSRole *role = entry.role;
+    int fd = entry.fd;
+    int events = entry.events;
+    entry.events = 0;
+    if (!role)
+    {
+        spdlog::warn("[{}] CSLSGroup::dispatch, worker_number={:d}, role is null, sock={:d}, why?",
+                     fmt::ptr(this), m_worker_number, fd);
+        return 0;
+    }
+
+    int ret = role->handler();
+    if (ret < 0)
+    {
+        // handle exception
+        spdlog::trace("[{}] CSLSGroup::dispatch, worker_number={:d}, sock={:d} is invalid, events={:d}, {}={}, role_map.size={:d}.",
+                      fmt::ptr(this), m_worker_number, fd, events, role->get_role_name(), fmt::ptr(role), m_roles.size());
+        role->invalid_srt();
+        check_role_now(fd);
+        return 0;
+    }
+    if ((events & (SRT_EPOLL_IN | SRT_EPOLL_OUT)) == (SRT_EPOLL_IN | SRT_EPOLL_OUT))
+    {
+        // SRT_EPOLL_ERR, reported in both lists
+        check_role_now(fd);
+    }
+    return ret;
+}
+
+//service the writers whose stream has new data, they are not polled for write while they sleep.
+int CSLSGroup::check_ready_roles()
+{
+    int handler_count = 0;
+    m_ready_queue.pop_all(m_ready_fds);
+    for (int fd : m_ready_fds)
+    {
+        CSLSRole *role = m_roles.find(fd);
+        if (NULL == role)
         {
-            spdlog::warn("[{}] CSLSGroup::handle, worker_number={:d}, role is null, writable sock={:d}, why?",
-                         fmt::ptr(this), m_worker_number, m_write_socks[i]);
+            // the role is gone
             continue;
         }
-
-        ret = role->handler();
+        int ret = role->handler_ready();
         if (ret < 0)
         {
-            // handle exception
-            spdlog::trace("[{}] CSLSGroup::handle, worker_number={:d}, write sock={:d} is invalid, {}={}, write_len={:d}, role_map.size={:d}.",
-                          fmt::ptr(this), m_worker_number, m_write_socks[i], role->get_role_name(), fmt::ptr(role), write_len, m_map_role.size());
+            spdlog::trace("[{}] CSLSGroup::check_ready_roles, worker_number={:d}, ready sock={:d} is invalid, {}={}.",
+                          fmt::ptr(this), m_worker_number, fd, role->get_role_name(), fmt::ptr(role));
             role->invalid_srt();
+            check_role_now(fd);
         }
         else
         {
             handler_count += ret;
         }
     }
+    return handler_count;
+}
 
-    for (i = 0; i < read_len; i++)
+void CSLSGroup::idle_check()
+{
+    check_wait_http_role();
+    check_timers(sls_gettime_ms());
+    check_migration();
+    check_new_role();
+    if (m_list_role)
     {
-        std::map<int, CSLSRole *>::iterator it = m_map_role.find(m_read_socks[i]);
-        if (it == m_map_role.end())
-        {
-            spdlog::warn("[{}] CSLSGroup::handle, worker_number={:d}, no role map readable sock={:d}, why?",
-                         fmt::ptr(this), m_worker_number, m_read_socks[i]);
+        m_list_role->set_role_count(m_worker_number, m_roles.size());
+    }
+    check_load();
+}
+
+//publish the busy time and the bytes of the worker once per second for the rebalancer.
+void CSLSGroup::check_load()
+{
+    int64_t cur_time = sls_gettime();
+    int64_t d = cur_time - m_load_begin_tm;
+    if (d < 1000000)
+        return;
+    if (m_list_role && m_load_begin_tm > 0)
+    {
+        int64_t busy = d > m_load_wait_time ? d - m_load_wait_time : 0;
+        int64_t bytes = m_load_bytes * 1000000 / d;
+        int loop_time = m_loop_count > 0 ? m_loop_time / m_loop_count : 0;
+        m_list_role->set_load(m_worker_number, busy * 1000 / d, bytes);
+        m_list_role->set_loop_time(m_worker_number, loop_time, m_loop_max_time);
+        check_overload(loop_time, bytes);
+        m_list_role->set_placement(m_worker_number, sched_getcpu(), m_cpu_node);
+    }
+    m_load_begin_tm = cur_time;
+    m_load_wait_time = 0;
+    m_load_bytes = 0;
+    m_loop_time = 0;
+    m_loop_max_time = 0;
+    m_loop_count = 0;
+}
+
+//the work of one loop after its wait, the delay of an event which arrives meanwhile.
+void CSLSGroup::end_loop()
+{
+    int64_t loop_time = sls_gettime() - m_loop_begin_tm;
+    m_loop_time += loop_time;
+    m_loop_count++;
+    if (loop_time > m_loop_max_time)
+    {
+        m_loop_max_time = loop_time;
+    }
+}
+
+//an overloaded worker refuses new players first, it closes viewers
+//when it is still overloaded a second later, the publishers are kept.
+void CSLSGroup::check_overload(int loop_time, int64_t bytes)
+{
+    bool overloaded = (m_overload_loop_time > 0 && loop_time >= m_overload_loop_time) ||
+                      (m_overload_bytes > 0 && bytes >= m_overload_bytes);
+    if (overloaded != m_list_role->is_overloaded(m_worker_number))
+    {
+        spdlog::warn("[{}] CSLSGroup::check_overload, worker_number={:d}, overloaded={}, loop_time={:d}us, bytes={:d}/s.",
+                     fmt::ptr(this), m_worker_number, overloaded, loop_time, bytes);
+        m_list_role->set_overloaded(m_worker_number, overloaded);
+    }
+    m_overload_count = overloaded ? m_overload_count + 1 : 0;
+    if (m_overload_count > 1 && m_overload_shed > 0)
+    {
+        shed_viewers(m_overload_shed);
+    }
+}
+
+//close the players of the lowest priority, the time shifted ones first, then the latest ones.
+//the parked players cost nothing and the pushers feed other servers, they are kept.
+void CSLSGroup::shed_viewers(int count)
+{
+    std::vector<std::tuple<bool, int, int>> viewers; //live, uptime, fd
+    for (int i = 0; i < m_roles.size(); i++)
+    {
+        CSLSRole *role = m_roles.at(i).role;
+        if (NULL == role || NULL == dynamic_cast<CSLSPlayer *>(role) || role->is_parked())
             continue;
-        }
+        viewers.push_back(std::make_tuple(!role->is_timeshift(), role->get_uptime(), m_roles.at(i).fd));
+    }
+    std::sort(viewers.begin(), viewers.end());
 
-        CSLSRole *role = it->second;
-        if (!role)
-        {
-            spdlog::warn("[{}] CSLSGroup::handle, worker_number={:d}, role is null, readable sock={:d}, why?",
-                         fmt::ptr(this), m_worker_number, m_read_socks[i]);
+    int64_t cur_time_ms = sls_gettime_ms();
+    int shed = 0;
+    for (int i = 0; i < (int)viewers.size() && shed < count; i++)
+    {
+        int fd = std::get<2>(viewers[i]);
+        int index = m_roles.find_index(fd);
+        if (index < 0)
             continue;
-        }
+        CSLSRole *role = m_roles.at(index).role;
+        spdlog::warn("[{}] CSLSGroup::shed_viewers, worker_number={:d}, close {}={}, fd={:d}, key={}.",
+                     fmt::ptr(this), m_worker_number, role->get_role_name(), fmt::ptr(role), fd, role->get_map_data_key());
+        role->invalid_srt();
+        check_role(fd, m_roles.at(index).check_tm, cur_time_ms);
+        shed++;
+    }
+    m_list_role->add_shed(m_worker_number, shed);
+}
 
-        ret = role->handler();
-        if (ret < 0)
-        {
-            // handle exception
-            spdlog::trace("[{}] CSLSGroup::handle, worker_number={:d}, readable sock={:d} is invalid, {}={}, readable len={:d}, role_map.size={:d}.",
-                          fmt::ptr(this), m_worker_number, m_read_socks[i], role->get_role_name(), fmt::ptr(role), read_len, m_map_role.size());
-            role->invalid_srt();
-        }
-        else
+//move the stream closest to the requested bytes per second, with all its roles in this worker,
+//to the requested worker. the sockets keep their data while they are out of any epoll.
+void CSLSGroup::check_migration()
+{
+    int target = -1;
+    int64_t bytes = 0;
+    if (NULL == m_list_role || !m_list_role->take_migration(m_worker_number, target, bytes))
+        return;
+    if (target == (int)m_worker_number)
+        return;
+
+    std::map<std::string, int64_t> map_stream;
+    for (int i = 0; i < m_roles.size(); i++)
+    {
+        CSLSRole *role = m_roles.at(i).role;
+        if (NULL == role || NULL == role->get_map_data_key() || 0 == strlen(role->get_map_data_key()))
+            continue;
+        map_stream[role->get_map_data_key()] += (int64_t)role->get_bitrate() * 1000 / 8;
+    }
+
+    //a stream bigger than twice the request would only move the load.
+    std::string key;
+    int64_t best = -1;
+    for (std::map<std::string, int64_t>::iterator it_stream = map_stream.begin(); it_stream != map_stream.end(); it_stream++)
+    {
+        int64_t v = it_stream->second;
+        if (v <= 0 || v >= 2 * bytes)
+            continue;
+        int64_t diff = v > bytes ? v - bytes : bytes - v;
+        if (best < 0 || diff < best)
         {
-            handler_count += ret;
+            best = diff;
+            key = it_stream->first;
         }
     }
+    if (key.empty())
+    {
+        spdlog::info("[{}] CSLSGroup::check_migration, worker_number={:d}, no stream fits bytes={:d}/s, streams={:d}.",
+                     fmt::ptr(this), m_worker_number, bytes, map_stream.size());
+        return;
+    }
 
-    idle_check();
-    if (0 == handler_count)
+    //the target pops no roles beyond worker_connections, they would wait outside any epoll.
+    int count = 0;
+    for (int i = 0; i < m_roles.size(); i++)
     {
-        // release cpu
-        msleep(POLLING_TIME);
+        CSLSRole *role = m_roles.at(i).role;
+        if (role && key == role->get_map_data_key())
+            count++;
+    }
+    if (!m_list_role->has_room(target, count))
+    {
+        spdlog::info("[{}] CSLSGroup::check_migration, worker_number={:d}, key={}, roles={:d}, worker {:d} has no room.",
+                     fmt::ptr(this), m_worker_number, key, count, target);
+        return;
     }
-    return handler_count;
-}
 
-void CSLSGroup::idle_check()
-{
-    check_wait_http_role();
-    check_reconnect_relay();
-    check_invalid_sock();
-    check_new_role();
+    //the new roles of the stream follow it.
+    m_list_role->set_home(key.c_str(), target);
+    count = 0;
+    for (int i = m_roles.size() - 1; i >= 0; i--)
+    {
+        CSLSRole *role = m_roles.at(i).role;
+        if (NULL == role || key != role->get_map_data_key())
+            continue;
+        role->leave_worker();
+        m_roles.erase(m_roles.at(i).fd);
+        m_list_role->push(role, target);
+        count++;
+    }
+    m_list_role->add_migrated(m_worker_number);
+    spdlog::info("[{}] CSLSGroup::check_migration, worker_number={:d}, key={}, bytes={:d}/s, roles={:d}, move to worker {:d}.",
+                 fmt::ptr(this), m_worker_number, key, map_stream[key], count, target);
 }
 
 void CSLSGroup::check_wait_http_role()
@@ -271,113 +550,143 @@ void CSLSGroup::check_wait_http_role()
     }
 }
 
-void CSLSGroup::check_reconnect_relay()
+//only the due timers are handled, the cost doesn't grow with the roles of the worker.
+void CSLSGroup::check_timers(int64_t cur_time_ms)
 {
-    int64_t cur_time_ms = sls_gettime_ms(); // m_cur_time_microsec;
-
-    CSLSRelayManager *relay_manager = NULL;
-    std::list<CSLSRelayManager *>::iterator it_erase;
-    std::list<CSLSRelayManager *>::iterator it;
-    for (it = m_list_reconnect_relay_manager.begin(); it != m_list_reconnect_relay_manager.end();)
+    m_expired_timers.clear();
+    m_timers.expire(cur_time_ms, m_expired_timers);
+    for (SLSTimer &timer : m_expired_timers)
     {
-        CSLSRelayManager *relay_manager = *it;
-        if (NULL == relay_manager)
-        {
-            spdlog::info("[{}] CSLSGroup::check_reconnect_relay, worker_number={:d}, remove invalid relay_manager.",
-                         fmt::ptr(this), m_worker_number);
-            it_erase = it;
-            it++;
-            m_list_reconnect_relay_manager.erase(it_erase);
-            continue;
-        }
-        int ret = relay_manager->reconnect(cur_time_ms);
-        if (SLS_OK != ret)
+        switch (timer.type)
         {
-            it++;
-            continue;
+        case GROUP_TIMER_ROLE:
+            check_role(timer.id, timer.expire_ms, cur_time_ms);
+            break;
+        case GROUP_TIMER_RELAY:
+            check_reconnect_relay((CSLSRelayManager *)timer.data, cur_time_ms);
+            break;
+        case GROUP_TIMER_STAT:
+            check_stat(cur_time_ms);
+            break;
         }
-        it_erase = it;
-        it++;
-        m_list_reconnect_relay_manager.erase(it_erase);
     }
 }
 
-void CSLSGroup::check_invalid_sock()
+//a role has one current timer, the ones it replaced are ignored.
+void CSLSGroup::schedule_role(int index, int64_t cur_time_ms)
 {
-    bool update_stat_info = false;
-    int64_t cur_time_ms = sls_gettime_ms();
-    int d = cur_time_ms - m_stat_post_last_tm_ms;
-    if (d >= m_stat_post_interval * 1000)
+    if (index < 0)
+        return;
+    SLSRoleEntry &entry = m_roles.at(index);
+    int64_t interval = (entry.role && entry.role->is_waiting()) ? POLLING_TIME : ROLE_CHECK_TIME;
+    entry.check_tm = cur_time_ms + interval;
+    m_timers.add(entry.check_tm, GROUP_TIMER_ROLE, entry.fd);
+}
+
+//the socket reported an error, check the role in this loop.
+void CSLSGroup::check_role_now(int fd)
+{
+    int index = m_roles.find_index(fd);
+    if (index < 0)
+        return;
+    SLSRoleEntry &entry = m_roles.at(index);
+    entry.check_tm = sls_gettime_ms();
+    m_timers.add(entry.check_tm, GROUP_TIMER_ROLE, fd);
+}
+
+void CSLSGroup::check_reconnect_relay(CSLSRelayManager *relay_manager, int64_t cur_time_ms)
+{
+    if (NULL == relay_manager)
     {
-        update_stat_info = true;
-        m_stat_info.clear();
-        m_stat_post_last_tm_ms = cur_time_ms;
+        spdlog::info("[{}] CSLSGroup::check_reconnect_relay, worker_number={:d}, remove invalid relay_manager.",
+                     fmt::ptr(this), m_worker_number);
+        return;
     }
+    int ret = relay_manager->reconnect(cur_time_ms);
+    if (SLS_OK != ret)
+    {
+        m_timers.add(cur_time_ms + RELAY_CHECK_TIME, GROUP_TIMER_RELAY, 0, relay_manager);
+    }
+}
 
-    std::map<int, CSLSRole *>::iterator it;
-    std::map<int, CSLSRole *>::iterator it_erase;
-    for (it = m_map_role.begin(); it != m_map_role.end();)
+void CSLSGroup::check_stat(int64_t cur_time_ms)
+{
     {
-        CSLSRole *role = it->second;
-        it_erase = it;
-        it++;
-        if (!role)
+        CSLSLock lock(&m_mutex_stat);
+        m_stat_info.clear();
+        for (int i = 0; i < m_roles.size(); i++)
         {
-            m_map_role.erase(it_erase);
-            continue;
+            if (m_roles.at(i).role)
+            {
+                m_stat_info.push_back(m_roles.at(i).role->get_stat_info());
+            }
         }
+    }
+    m_timers.add(cur_time_ms + m_stat_post_interval * 1000, GROUP_TIMER_STAT, 0);
+}
 
-        if (update_stat_info)
-        {
+void CSLSGroup::check_role(int fd, int64_t expire_ms, int64_t cur_time_ms)
+{
+    int index = m_roles.find_index(fd);
+    if (index < 0 || m_roles.at(index).check_tm != expire_ms)
+    {
+        // the role is gone or has a newer timer
+        return;
+    }
+    CSLSRole *role = m_roles.at(index).role;
+    if (!role)
+    {
+        m_roles.erase(fd);
+        return;
+    }
 
-            stat_info_t stat_info = role->get_stat_info();
+    if (role->is_parked())
+    {
+        role->check_parked(cur_time_ms);
+    }
+    role->check_http_wait();
 
-            CSLSLock lock(&m_mutex_stat);
-            m_stat_info.push_back(stat_info);
+    int state = role->get_state(cur_time_ms);
+    if (SLS_RS_INVALID == state || SLS_RS_UNINIT == state)
+    {
+        spdlog::info("[{}] CSLSGroup::check_role, worker_number={:d}, {}={}, invalid sock={:d}, state={:d}, role_map.size={:d}.",
+                     fmt::ptr(this), m_worker_number, role->get_role_name(), fmt::ptr(role), fd, state, m_roles.size());
+        // check relay
+        if (role->is_reconnect())
+        {
+            CSLSRelay *relay = (CSLSRelay *)role;
+            CSLSRelayManager *relay_manager = (CSLSRelayManager *)relay->get_relay_manager();
+            m_timers.add(cur_time_ms + RELAY_CHECK_TIME, GROUP_TIMER_RELAY, 0, relay_manager);
+            spdlog::info("[{}] CSLSGroup::check_role, worker_number={:d}, {}={}, need reconnect.",
+                         fmt::ptr(this), m_worker_number, role->get_role_name(), fmt::ptr(role));
         }
 
-        int state = role->get_state(cur_time_ms);
-        if (SLS_RS_INVALID == state || SLS_RS_UNINIT == state)
+        role->uninit();
+        if (SLS_OK == role->check_http_client())
         {
-            spdlog::info("[{}] CSLSGroup::check_invalid_sock, worker_number={:d}, {}={}, invalid sock={:d}, state={:d}, role_map.size={:d}.",
-                         fmt::ptr(this), m_worker_number, role->get_role_name(), fmt::ptr(role), role->get_fd(), state, m_map_role.size());
-            // check relay
-            if (role->is_reconnect())
-            {
-                CSLSRelay *relay = (CSLSRelay *)role;
-                CSLSRelayManager *relay_manager = (CSLSRelayManager *)relay->get_relay_manager();
-                m_list_reconnect_relay_manager.push_back(relay_manager);
-                spdlog::info("[{}] CSLSGroup::check_invalid_sock, worker_number={:d}, {}={}, need reconnect.",
-                             fmt::ptr(this), m_worker_number, role->get_role_name(), fmt::ptr(role));
-            }
-
-            role->uninit();
-            if (SLS_OK == role->check_http_client())
-            {
-                m_list_wait_http_role.push_back(role);
-                spdlog::info("[{}] CSLSGroup::check_invalid_sock, worker_number={:d}, {}={}, put into m_list_wait_http_role.",
-                             fmt::ptr(this), m_worker_number, role->get_role_name(), fmt::ptr(role));
-            }
-            else
-            {
-                spdlog::info("[{}] CSLSGroup::check_invalid_sock, worker_number={:d}, {}={}, delete.",
-                             fmt::ptr(this), m_worker_number, role->get_role_name(), fmt::ptr(role));
-                delete role;
-            }
-            m_map_role.erase(it_erase);
-            continue;
+            m_list_wait_http_role.push_back(role);
+            spdlog::info("[{}] CSLSGroup::check_role, worker_number={:d}, {}={}, put into m_list_wait_http_role.",
+                         fmt::ptr(this), m_worker_number, role->get_role_name(), fmt::ptr(role));
         }
+        else
+        {
+            spdlog::info("[{}] CSLSGroup::check_role, worker_number={:d}, {}={}, delete.",
+                         fmt::ptr(this), m_worker_number, role->get_role_name(), fmt::ptr(role));
+            delete role;
+        }
+        m_roles.erase(fd);
+        return;
     }
+    schedule_role(index, cur_time_ms);
 }
 
 void CSLSGroup::clear()
 {
     spdlog::info("[{}] CSLSGroup::clear, worker_number={:d}, role_map.size={:d}.",
-                 fmt::ptr(this), m_worker_number, m_map_role.size());
-    std::map<int, CSLSRole *>::iterator it;
-    for (it = m_map_role.begin(); it != m_map_role.end(); it++)
+                 fmt::ptr(this), m_worker_number, m_roles.size());
+    for (int i = 0; i < m_roles.size(); i++)
     {
-        CSLSRole *role = it->second;
+        CSLSRole *role = m_roles.at(i).role;
         if (role)
         {
             spdlog::info("[{}] CSLSGroup::clear, worker_number={:d}, delete {}={}.",
@@ -386,7 +695,7 @@ void CSLSGroup::clear()
             delete role;
         }
     }
-    m_map_role.clear();
+    m_roles.clear();
 }
 
 void CSLSGroup::set_role_list(CSLSRoleList *list_role)
@@ -399,6 +708,18 @@ void CSLSGroup::set_worker_number(int n)
     m_worker_number = n;
 }
 
+void CSLSGroup::set_spin_time(int spin_time)
+{
+    m_spin_time = spin_time;
+}
+
+void CSLSGroup::set_overload(int loop_time, int64_t bytes, int shed)
+{
+    m_overload_loop_time = loop_time;
+    m_overload_bytes = bytes;
+    m_overload_shed = shed;
+}
+
 void CSLSGroup::set_worker_connections(unsigned int n)
 {
     m_worker_connections = n;
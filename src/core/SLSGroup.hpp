@@ -30,6 +30,9 @@
 #include "SLSRoleList.hpp"
 #include "SLSRole.hpp"
 #include "SLSMapRelay.hpp"
+#include "SLSReadyQueue.hpp"
+#include "SLSRoleTable.hpp"
+#include "SLSTimerWheel.hpp"
 #include "HttpClient.hpp"
 
 /**
@@ -43,12 +46,17 @@ public:
 
     int start();
     int stop();
+    int init_epoll();
+    int uninit_epoll();
     void reload();
 
     void set_role_list(CSLSRoleList *list_role);
     void set_worker_connections(unsigned int n);
     void set_worker_number(int n);
+    void set_spin_time(int spin_time);
+    void set_overload(int loop_time, int64_t bytes, int shed);
 
+    virtual int work();
     virtual int handler();
 
     void set_stat_post_interval(int interval);
@@ -62,21 +70,50 @@ protected:
 private:
     CSLSRoleList *m_list_role;
     std::list<CSLSRole *> m_list_wait_http_role;
-    std::map<int, CSLSRole *> m_map_role;
-    std::list<CSLSRelayManager *> m_list_reconnect_relay_manager;
+    CSLSRoleTable m_roles;
+    std::vector<int> m_event_roles; //indexes into m_roles with events of the current poll
+    CSLSReadyQueue m_ready_queue;   //writers whose stream has new data
+    std::vector<int> m_ready_fds;
+    CSLSTimerWheel m_timers;        //role checks, relay reconnects and stat sampling
+    std::vector<SLSTimer> m_expired_timers;
 
     void idle_check();
-    void check_reconnect_relay();
-    void check_invalid_sock();
+    void check_timers(int64_t cur_time_ms);
+    void check_role(int fd, int64_t expire_ms, int64_t cur_time_ms);
+    void check_role_now(int fd);
+    void schedule_role(int index, int64_t cur_time_ms);
+    void check_reconnect_relay(CSLSRelayManager *relay_manager, int64_t cur_time_ms);
+    void check_stat(int64_t cur_time_ms);
     void check_new_role();
+    void add_role(CSLSRole *role);
+    int dispatch(int index);
+    int check_ready_roles();
     void check_wait_http_role();
+    void check_load();
+    void end_loop();
+    void check_overload(int loop_time, int64_t bytes);
+    void shed_viewers(int count);
+    void check_migration();
 
     unsigned int m_worker_connections;
     unsigned int m_worker_number;
     int64_t m_cur_time_microsec;
+    int m_spin_time;              //us, keep polling after the last work before blocking
+    int m_cpu_node;               //numa node of the pinned cpus, -1: not pinned
+    int64_t m_last_active_tm;     //us
+    int64_t m_load_begin_tm;      //us, begin of the load window
+    int64_t m_load_wait_time;     //us blocked in epoll in the window
+    int64_t m_load_bytes;         //bytes moved in the window
+    int64_t m_loop_begin_tm;      //us, the end of the last wait
+    int64_t m_loop_time;          //us of work in the window
+    int64_t m_loop_max_time;      //us
+    int m_loop_count;
+    int m_overload_loop_time;     //us, average loop time which overloads the worker, 0: no limit
+    int64_t m_overload_bytes;     //bytes per second which overload the worker, 0: no limit
+    int m_overload_shed;          //viewers closed per second while refusing isn't enough, 0: never
+    int m_overload_count;         //seconds overloaded in a row
     bool m_reload;
 
-    int64_t m_stat_post_last_tm_ms;
     int m_stat_post_interval;
     CSLSMutex m_mutex_stat;
     std::vector<stat_info_t> m_stat_info;
@@ -21,6 +21,7 @@
  * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <errno.h>
 #include <string.h>
@@ -288,6 +289,11 @@ int CSLSListener::start()
     {
         m_srt->libsrt_set_latency(latency);
     }
+    int payload_size = ((sls_conf_server_t *)m_conf)->payload_size;
+    if (payload_size > 0)
+    {
+        m_srt->libsrt_set_payload_size(payload_size);
+    }
 
     m_port = ((sls_conf_server_t *)m_conf)->listen;
     ret = m_srt->libsrt_setup(m_port);
@@ -298,6 +304,14 @@ int CSLSListener::start()
     }
     spdlog::info("[{}] CSLSListener::start, libsrt_setup ok.", fmt::ptr(this));
 
+    ret = m_srt->libsrt_set_listen_callback(&CSLSListener::on_listen, this);
+    if (SLS_OK != ret)
+    {
+        spdlog::warn("[{}] CSLSListener::start, libsrt_set_listen_callback failure, overloaded workers won't refuse players.",
+                     fmt::ptr(this));
+        ret = SLS_OK;
+    }
+
     ret = m_srt->libsrt_listen(m_back_log);
     if (SLS_OK != ret)
     {
@@ -318,6 +332,53 @@ int CSLSListener::start()
     return ret;
 }
 
+//called by srt at the handshake, a player is refused before it costs the overloaded worker anything.
+int CSLSListener::on_listen(void *opaque, SRTSOCKET sock, int hs_version, const struct sockaddr *peer_addr, const char *streamid)
+{
+    CSLSListener *listener = (CSLSListener *)opaque;
+    if (NULL == listener || SLS_OK == listener->check_overload(streamid))
+        return 0;
+    srt_setrejectreason(sock, SRT_REJX_OVERLOAD);
+    return -1;
+}
+
+//return SLS_ERROR when the streamid is a player of a stream whose worker is overloaded,
+//anything else is left to the handler.
+int CSLSListener::check_overload(const char *streamid)
+{
+    char sid[1024] = {0};
+    char key_app[URL_MAX_LEN] = {0};
+    char key_stream_name[URL_MAX_LEN] = {0};
+
+    if (NULL == m_list_role || NULL == m_map_publisher)
+        return SLS_OK;
+
+    if (streamid && strlen(streamid) > 0)
+        strlcpy(sid, streamid, sizeof(sid));
+    else if (strlen(m_default_sid) != 0)
+        strlcpy(sid, m_default_sid, sizeof(sid));
+    else
+        strlcpy(sid, "uplive.sls.com/live/test", sizeof(sid));
+
+    std::map<std::string, std::string> sid_kv = m_srt->libsrt_parse_sid(sid);
+    if (!sid_kv.count("h") || !sid_kv.count("sls_app") || !sid_kv.count("r"))
+        return SLS_OK;
+
+    // publishers are never refused
+    snprintf(key_app, sizeof(key_app), "%s/%s", sid_kv.at("h").c_str(), sid_kv.at("sls_app").c_str());
+    std::string app_uplive = m_map_publisher->get_uplive(key_app);
+    if (app_uplive.length() == 0)
+        return SLS_OK;
+
+    snprintf(key_stream_name, sizeof(key_stream_name), "%s/%s", app_uplive.c_str(), sid_kv.at("r").c_str());
+    if (!m_list_role->check_overload(key_stream_name))
+        return SLS_OK;
+
+    spdlog::warn("[{}] CSLSListener::check_overload, refused, new player, stream={}, its worker is overloaded.",
+                 fmt::ptr(this), key_stream_name);
+    return SLS_ERROR;
+}
+
 int CSLSListener::stop()
 {
     int ret = SLS_OK;
@@ -432,63 +493,25 @@ int CSLSListener::handler()
     if (app_uplive.length() > 0)
     {
         snprintf(key_stream_name, sizeof(key_stream_name), "%s/%s", app_uplive.c_str(), stream_name);
+        // players of a stream which is not live yet may wait for it
+        ca = (sls_conf_app_t *)m_map_publisher->get_ca(app_uplive);
+        int wait_timeout = ca ? ca->player_wait_timeout : 0;
         CSLSRole *pub = m_map_publisher->get_publisher(key_stream_name);
         if (NULL == pub)
         {
-            //*
             // 3.1 check pullers
-            if (NULL == m_map_puller)
-            {
-                spdlog::info("[{}] CSLSListener::handler, refused, new role[{}:{:d}], stream='{}', publisher is NULL and m_map_puller is NULL.",
-                             fmt::ptr(this), peer_name, peer_port, key_stream_name);
-                srt->libsrt_close();
-                delete srt;
-                return client_count;
-            }
-            CSLSRelayManager *puller_manager = m_map_puller->add_relay_manager(app_uplive.c_str(), stream_name);
-            if (NULL == puller_manager)
-            {
-                spdlog::info("[{}] CSLSListener::handler, m_map_puller->add_relay_manager failed, new role[{}:{:d}], stream='{}', publisher is NULL, no puller_manager.",
-                             fmt::ptr(this), peer_name, peer_port, key_stream_name);
-                srt->libsrt_close();
-                delete srt;
-                return client_count;
-            }
-
-            puller_manager->set_map_data(m_map_data);
-            puller_manager->set_map_publisher(m_map_publisher);
-            puller_manager->set_role_list(m_list_role);
-            puller_manager->set_listen_port(m_port);
-
-            if (SLS_OK != puller_manager->start())
-            {
-                spdlog::info("[{}] CSLSListener::handler, puller_manager->start failed, new client[{}:{:d}], stream='{}'.",
-                             fmt::ptr(this), peer_name, peer_port, key_stream_name);
-                srt->libsrt_close();
-                delete srt;
-                return client_count;
-            }
-            spdlog::info("[{}] CSLSListener::handler, puller_manager->start ok, new client[{}:{:d}], stream={}.",
-                         fmt::ptr(this), peer_name, peer_port, key_stream_name);
-
-            pub = m_map_publisher->get_publisher(key_stream_name);
-            if (NULL == pub)
+            pub = start_puller(app_uplive.c_str(), stream_name, key_stream_name);
+            if (NULL == pub && wait_timeout <= 0)
             {
-                spdlog::info("[{}] CSLSListener::handler, m_map_publisher->get_publisher failed, new client[{}:{:d}], stream={}.",
+                spdlog::info("[{}] CSLSListener::handler, refused, new role[{}:{:d}], stream='{}', publisher is NULL.",
                              fmt::ptr(this), peer_name, peer_port, key_stream_name);
                 srt->libsrt_close();
                 delete srt;
                 return client_count;
             }
-            else
-            {
-                spdlog::info("[{}] CSLSListener::handler, m_map_publisher->get_publisher ok, pub={}, new client[{}:{:d}], stream={}.",
-                             fmt::ptr(this), fmt::ptr(pub), peer_name, peer_port, key_stream_name);
-            }
         }
 
         // Check if IP is allowed to stream from the app
-        ca = (sls_conf_app_t *)m_map_publisher->get_ca(app_uplive);
         if (ca == nullptr)
         {
             spdlog::error("[{}] CSLSListener::handler, refused, configuration does not exist [stream={}]",
@@ -545,7 +568,8 @@ int CSLSListener::handler()
         }
 
         // 3.2 handle new play
-        if (!m_map_data->is_exist(key_stream_name))
+        bool waiting = !m_map_data->is_exist(key_stream_name);
+        if (waiting && wait_timeout <= 0)
         {
             spdlog::error("[{}] CSLSListener::handler, refused, new role[{}:{:d}], stream={}, but publisher data doesn't exist in m_map_data.",
                           fmt::ptr(this), peer_name, peer_port, key_stream_name);
@@ -564,6 +588,31 @@ int CSLSListener::handler()
         player->set_idle_streams_timeout(m_idle_streams_timeout_role);
         player->set_srt(srt);
         player->set_map_data(key_stream_name, m_map_data);
+        player->set_gop_cache(strcmp(ca->gop_cache, "on") == 0);
+        if (sid_kv.count("offset"))
+        {
+            // join behind the live edge, served from the time shift buffer
+            int64_t offset = sls_parse_duration_ms(sid_kv.at("offset").c_str());
+            if (offset < 0 || ca->timeshift_duration <= 0)
+            {
+                spdlog::warn("[{}] CSLSListener::handler, new player[{}:{:d}], offset='{}' is ignored, timeshift_duration={:d}.",
+                             fmt::ptr(this), peer_name, peer_port, sid_kv.at("offset"), ca->timeshift_duration);
+            }
+            else if (offset > 0)
+            {
+                offset = std::min(offset, (int64_t)ca->timeshift_duration * 1000);
+                player->set_timeshift(offset);
+                spdlog::info("[{}] CSLSListener::handler, new player[{}:{:d}], stream={}, play {:d}ms behind live.",
+                             fmt::ptr(this), peer_name, peer_port, key_stream_name, offset);
+            }
+        }
+        if (waiting)
+        {
+            // parked without egress until the publisher appears
+            player->set_wait_stream_timeout(wait_timeout * 1000);
+            spdlog::info("[{}] CSLSListener::handler, new player[{}:{:d}], stream={} is not live, wait for {:d}s.",
+                         fmt::ptr(this), peer_name, peer_port, key_stream_name, wait_timeout);
+        }
 
         // stat info
         stat_info_t *stat_info_obj = new stat_info_t();
@@ -643,9 +692,11 @@ int CSLSListener::handler()
         spdlog::error("[{}] CSLSListener::handler Accepting connection by default", fmt::ptr(this));
     }
 
-    // Check if publisher for the stream already exists
+    // Check if publisher for the stream already exists, a second one may be the standby
     CSLSRole *publisher = m_map_publisher->get_publisher(key_stream_name);
-    if (NULL != publisher)
+    bool standby = NULL != publisher && ca->publisher_stall_timeout > 0 &&
+                   NULL == m_map_publisher->get_standby(key_stream_name);
+    if (NULL != publisher && !standby)
     {
         spdlog::error("[{}] CSLSListener::handler, refused, new role[{}:{:d}], stream='{}',but publisher={} is not NULL.",
                       fmt::ptr(this), peer_name, peer_port, key_stream_name, fmt::ptr(publisher));
@@ -653,7 +704,11 @@ int CSLSListener::handler()
         delete srt;
         return client_count;
     }
-    // create new publisher
+    // create new publisher, non blocking so that it can be drained per event
+    if (srt->libsrt_socket_nonblock(0) < 0)
+        spdlog::warn("[{}] CSLSListener::handler, new publisher[{}:{:d}], libsrt_socket_nonblock failed.",
+                     fmt::ptr(this), peer_name, peer_port);
+
     CSLSPublisher *pub = new CSLSPublisher;
     pub->set_srt(srt);
     pub->set_conf((sls_conf_base_t *)ca);
@@ -689,11 +744,41 @@ int CSLSListener::handler()
     }
     pub->set_record_hls_path(tmp);
 
-    spdlog::info("[{}] CSLSListener::handler, new pub={}, key_stream_name={}.",
-                 fmt::ptr(this), fmt::ptr(pub), key_stream_name);
+    spdlog::info("[{}] CSLSListener::handler, new pub={}, key_stream_name={}, standby={:d}.",
+                 fmt::ptr(this), fmt::ptr(pub), key_stream_name, standby);
+
+    if (standby)
+    {
+        // the stream exists already, the standby writes it only after the publisher stalls
+        if (SLS_OK != m_map_publisher->set_push_2_standby(key_stream_name, pub))
+        {
+            spdlog::warn("[{}] CSLSListener::handler, m_map_publisher->set_push_2_standby failed, key_stream_name={}.",
+                         fmt::ptr(this), key_stream_name);
+            pub->uninit();
+            delete pub;
+            pub = NULL;
+            return client_count;
+        }
+        pub->set_map_publisher(m_map_publisher);
+        pub->set_map_data(key_stream_name, m_map_data);
+        pub->on_connect();
+        m_list_role->push(pub);
+        spdlog::info("[{}] CSLSListener::handler, new standby publisher[{}:{:d}], key_stream_name={}.",
+                     fmt::ptr(this), peer_name, peer_port, key_stream_name);
+        return client_count;
+    }
 
     // init data array
-    if (SLS_OK != m_map_data->add(key_stream_name))
+    SLSRingConf ring_conf;
+    ring_conf.min_size = ca->ring_min_size * 1024;
+    ring_conf.max_size = ca->ring_max_size * 1024;
+    ring_conf.latency = ((sls_conf_server_t *)m_conf)->latency;
+    ring_conf.message_mode = strcmp(ca->ring_message_mode, "on") == 0;
+    SLSTimeShiftConf timeshift_conf;
+    timeshift_conf.duration = ca->timeshift_duration * 1000;
+    timeshift_conf.memory = ca->timeshift_memory * 1000;
+    strlcpy(timeshift_conf.path, ca->timeshift_path, sizeof(timeshift_conf.path));
+    if (SLS_OK != m_map_data->add(key_stream_name, &ring_conf, &timeshift_conf))
     {
         spdlog::warn("[{}] CSLSListener::handler, m_map_data->add failed, new pub[{}:{:d}], stream={}.",
                      fmt::ptr(this), peer_name, peer_port, key_stream_name);
@@ -744,6 +829,51 @@ int CSLSListener::handler()
     return client_count;
 }
 
+//pull the stream from the relay upstreams of the app, return the puller or NULL.
+CSLSRole *CSLSListener::start_puller(const char *app_uplive, const char *stream_name, const char *key_stream_name)
+{
+    if (NULL == m_map_puller)
+    {
+        spdlog::info("[{}] CSLSListener::start_puller, stream='{}', publisher is NULL and m_map_puller is NULL.",
+                     fmt::ptr(this), key_stream_name);
+        return NULL;
+    }
+    CSLSRelayManager *puller_manager = m_map_puller->add_relay_manager(app_uplive, stream_name);
+    if (NULL == puller_manager)
+    {
+        spdlog::info("[{}] CSLSListener::start_puller, m_map_puller->add_relay_manager failed, stream='{}', publisher is NULL, no puller_manager.",
+                     fmt::ptr(this), key_stream_name);
+        return NULL;
+    }
+
+    puller_manager->set_map_data(m_map_data);
+    puller_manager->set_map_publisher(m_map_publisher);
+    puller_manager->set_role_list(m_list_role);
+    puller_manager->set_listen_port(m_port);
+
+    if (SLS_OK != puller_manager->start())
+    {
+        spdlog::info("[{}] CSLSListener::start_puller, puller_manager->start failed, stream='{}'.",
+                     fmt::ptr(this), key_stream_name);
+        return NULL;
+    }
+    spdlog::info("[{}] CSLSListener::start_puller, puller_manager->start ok, stream={}.",
+                 fmt::ptr(this), key_stream_name);
+
+    CSLSRole *pub = m_map_publisher->get_publisher(key_stream_name);
+    if (NULL == pub)
+    {
+        spdlog::info("[{}] CSLSListener::start_puller, m_map_publisher->get_publisher failed, stream={}.",
+                     fmt::ptr(this), key_stream_name);
+    }
+    else
+    {
+        spdlog::info("[{}] CSLSListener::start_puller, m_map_publisher->get_publisher ok, pub={}, stream={}.",
+                     fmt::ptr(this), fmt::ptr(pub), key_stream_name);
+    }
+    return pub;
+}
+
 stat_info_t CSLSListener::get_stat_info()
 {
     if (m_stat_info.port == 0)
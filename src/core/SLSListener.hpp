@@ -44,9 +44,11 @@ char domain_publisher[URL_MAX_LEN];
 int listen;
 int backlog;
 int latency;
+int payload_size;
 int idle_streams_timeout; //unit s; -1: unlimited
 char on_event_url[URL_MAX_LEN];
 char default_sid[STR_MAX_LEN];
+int worker_threads; //0: the workers of srt
 SLS_CONF_DYNAMIC_DECLARE_END
 
 /**
@@ -58,9 +60,11 @@ SLS_SET_CONF(server, string, domain_player, "play domain", 1, URL_MAX_LEN - 1),
     SLS_SET_CONF(server, int, listen, "listen port", 1, 65535),
     SLS_SET_CONF(server, int, backlog, "how many sockets may be allowed to wait until they are accepted", 1, 1024),
     SLS_SET_CONF(server, int, latency, "latency.", 1, 5000),
+    SLS_SET_CONF(server, int, payload_size, "max srt payload size, unit byte.", TS_PACK_LEN, SRT_LIVE_MAX_PAYLOAD_LEN),
     SLS_SET_CONF(server, int, idle_streams_timeout, "players idle timeout when no publisher", -1, 86400),
     SLS_SET_CONF(server, string, on_event_url, "on connect/close http url", 1, URL_MAX_LEN - 1),
     SLS_SET_CONF(server, string, default_sid, "default sid to use when no streamid is given", 1, STR_MAX_LEN - 1),
+    SLS_SET_CONF(server, int, worker_threads, "count of worker threads of the server only, 0: use the shared workers.", 0, 100),
     SLS_CONF_CMD_DYNAMIC_DECLARE_END
 
     /**
@@ -103,4 +107,7 @@ private:
     char m_record_hls_path_prefix[URL_MAX_LEN];
 
     int init_conf_app();
+    int check_overload(const char *streamid);
+    static int on_listen(void *opaque, SRTSOCKET sock, int hs_version, const struct sockaddr *peer_addr, const char *streamid);
+    CSLSRole *start_puller(const char *app_uplive, const char *stream_name, const char *key_stream_name);
 };
@@ -23,6 +23,8 @@
 
 #include <errno.h>
 #include <string.h>
+#include <algorithm>
+#include <set>
 #include "spdlog/spdlog.h"
 
 #include <nlohmann/json.hpp>
@@ -50,6 +52,9 @@ CSLSManager::CSLSManager()
     m_server_count = 1;
     m_list_role = NULL;
     m_single_group = NULL;
+    m_balance_interval = 0;
+    m_balance_load = 0;
+    m_balance_last_tm_ms = 0;
 
     m_map_data = NULL;
     m_map_publisher = NULL;
@@ -97,16 +102,84 @@ int CSLSManager::start()
     m_map_publisher = new CSLSMapPublisher[m_server_count];
     m_map_puller = new CSLSMapRelay[m_server_count];
     m_map_pusher = new CSLSMapRelay[m_server_count];
+    for (i = 0; i < m_server_count; i++)
+    {
+        m_map_data[i].set_ring_lock_free(strcmp(conf_srt->ring_lock_free, "on") == 0);
+    }
+
+    //worker cpus, worker i is pinned to the i-th cpu of the list
+    std::vector<int> worker_cpus;
+    if (strlen(conf_srt->worker_cpus) > 0 && sls_parse_cpu_list(conf_srt->worker_cpus, worker_cpus) < 0)
+    {
+        spdlog::error("[{}] CSLSManager::start, invalid worker_cpus='{}'.", fmt::ptr(this), conf_srt->worker_cpus);
+        worker_cpus.clear();
+    }
+
+    //the ingest pool is the first workers, only with worker threads
+    int ingest_threads = conf_srt->worker_threads > 0 ? conf_srt->ingest_threads : 0;
+    m_worker_threads = conf_srt->worker_threads + ingest_threads;
+    int total_threads = m_worker_threads;
+    for (i = 0; i < m_server_count; i++)
+    {
+        total_threads += conf->worker_threads;
+        conf = (sls_conf_server_t *)conf->sibling;
+    }
+    conf = conf_server;
+
+    //ring arena, shared by all managers across reloads
+    CSLSRingArena *ring_arena = CSLSRingArena::get_instance();
+    ring_arena->set_hugepage(strcmp(conf_srt->ring_hugepage, "on") == 0);
+    bool ring_numa = strcmp(conf_srt->ring_numa, "on") == 0;
+    if (ring_numa && worker_cpus.empty())
+    {
+        spdlog::warn("[{}] CSLSManager::start, ring_numa is on without worker_cpus, the rings are not placed on numa nodes.",
+                     fmt::ptr(this));
+    }
+    ring_arena->set_numa(ring_numa && !worker_cpus.empty());
+    if (conf_srt->ring_arena_size > 0)
+    {
+        //split among the nodes of the pinned workers
+        std::set<int> nodes;
+        for (i = 0; i < total_threads && !worker_cpus.empty(); i++)
+        {
+            nodes.insert(sls_get_cpu_node(worker_cpus[i % worker_cpus.size()]));
+        }
+        if (nodes.empty())
+        {
+            nodes.insert(-1);
+        }
+        for (int node : nodes)
+        {
+            ring_arena->reserve((int64_t)conf_srt->ring_arena_size * 1024 * 1024 / nodes.size(), node);
+        }
+    }
 
     //role list
     m_list_role = new CSLSRoleList;
+    m_list_role->set_worker_count(m_worker_threads);
+    m_list_role->set_ingest_count(ingest_threads);
+    m_list_role->set_spread_viewers(conf_srt->worker_spread_viewers);
+    m_list_role->set_worker_connections(conf_srt->worker_connections);
+    m_worker_sets.push_back(SLSWorkerSet{m_list_role, 0});
     spdlog::info("[{}] CSLSManager::start, new m_list_role={}.", fmt::ptr(this), fmt::ptr(m_list_role));
 
     //create listeners according config, delete by groups
     for (i = 0; i < m_server_count; i++)
     {
+        //a server with its own workers has its own role list
+        CSLSRoleList *list_role = m_list_role;
+        if (conf->worker_threads > 0)
+        {
+            list_role = new CSLSRoleList;
+            list_role->set_worker_count(conf->worker_threads);
+            list_role->set_spread_viewers(conf_srt->worker_spread_viewers);
+            list_role->set_worker_connections(conf_srt->worker_connections);
+            m_worker_sets.push_back(SLSWorkerSet{list_role, conf->listen});
+            spdlog::info("[{}] CSLSManager::start, listen={:d}, own workers={:d}, list_role={}.",
+                         fmt::ptr(this), conf->listen, conf->worker_threads, fmt::ptr(list_role));
+        }
         CSLSListener *p = new CSLSListener(); //deleted by groups
-        p->set_role_list(m_list_role);
+        p->set_role_list(list_role);
         p->set_conf((sls_conf_base_t *)conf);
         p->set_record_hls_path_prefix(conf_srt->record_hls_path_prefix);
         p->set_map_data("", &m_map_data[i]);
@@ -130,13 +203,16 @@ int CSLSManager::start()
 
     //create groups
 
-    m_worker_threads = conf_srt->worker_threads;
+    int cpu_index = 0;
     if (m_worker_threads == 0)
     {
         CSLSGroup *p = new CSLSGroup();
         p->set_worker_number(0);
         p->set_role_list(m_list_role);
         p->set_worker_connections(conf_srt->worker_connections);
+        p->set_spin_time(conf_srt->worker_spin_time);
+        p->set_overload(conf_srt->worker_overload_lag, (int64_t)conf_srt->worker_overload_bitrate * 1000000 / 8,
+                        conf_srt->worker_overload_shed);
         p->set_stat_post_interval(conf_srt->stat_post_interval);
         if (SLS_OK != p->init_epoll())
         {
@@ -146,29 +222,60 @@ int CSLSManager::start()
         m_workers.push_back(p);
         m_single_group = p;
     }
-    else
+    else if (SLS_OK != start_workers(m_list_role, m_worker_threads, ingest_threads, conf_srt, worker_cpus, cpu_index))
     {
-        for (i = 0; i < m_worker_threads; i++)
+        return SLS_ERROR;
+    }
+    for (i = 1; i < (int)m_worker_sets.size(); i++)
+    {
+        CSLSRoleList *list_role = m_worker_sets[i].list_role;
+        if (SLS_OK != start_workers(list_role, list_role->get_worker_count(), 0, conf_srt, worker_cpus, cpu_index))
         {
-            CSLSGroup *p = new CSLSGroup();
-            p->set_worker_number(i);
-            p->set_role_list(m_list_role);
-            p->set_worker_connections(conf_srt->worker_connections);
-            p->set_stat_post_interval(conf_srt->stat_post_interval);
-            if (SLS_OK != p->init_epoll())
-            {
-                spdlog::error("[{}] CSLSManager::start, p->init_epoll failed.", fmt::ptr(this));
-                return SLS_ERROR;
-            }
-            p->start();
-            m_workers.push_back(p);
+            return SLS_ERROR;
         }
     }
-    spdlog::info("[{}] CSLSManager::start, init worker, count={:d}.", fmt::ptr(this), m_worker_threads);
+    spdlog::info("[{}] CSLSManager::start, init worker, count={:d}, ingest={:d}, total={:d}.",
+                 fmt::ptr(this), m_worker_threads, ingest_threads, total_threads);
+
+    m_balance_interval = conf_srt->worker_balance_interval * 1000;
+    m_balance_load = conf_srt->worker_balance_load > 0 ? conf_srt->worker_balance_load : 200;
 
     return ret;
 }
 
+//the groups of one role list, each on the next cpu of the list.
+int CSLSManager::start_workers(CSLSRoleList *list_role, int threads, int ingest_threads, sls_conf_srt_t *conf_srt,
+                               const std::vector<int> &worker_cpus, int &cpu_index)
+{
+    for (int i = 0; i < threads; i++)
+    {
+        CSLSGroup *p = new CSLSGroup();
+        p->set_worker_number(i);
+        p->set_role_list(list_role);
+        p->set_worker_connections(conf_srt->worker_connections);
+        p->set_spin_time(conf_srt->worker_spin_time);
+        p->set_overload(conf_srt->worker_overload_lag, (int64_t)conf_srt->worker_overload_bitrate * 1000000 / 8,
+                        conf_srt->worker_overload_shed);
+        p->set_stat_post_interval(conf_srt->stat_post_interval);
+        if (!worker_cpus.empty())
+        {
+            p->set_cpus(std::vector<int>(1, worker_cpus[cpu_index++ % worker_cpus.size()]));
+        }
+        if (i < ingest_threads)
+        {
+            p->set_priority(conf_srt->ingest_priority);
+        }
+        if (SLS_OK != p->init_epoll())
+        {
+            spdlog::error("[{}] CSLSManager::start_workers, p->init_epoll failed.", fmt::ptr(this));
+            return SLS_ERROR;
+        }
+        p->start();
+        m_workers.push_back(p);
+    }
+    return SLS_OK;
+}
+
 json CSLSManager::generate_json_for_publisher(std::string publisherName, int clear) {
     json ret;
     ret["status"] = "ok";
@@ -204,6 +311,117 @@ json CSLSManager::generate_json_for_all_publishers(int clear) {
             }
         }
     }
+    ret["arena"] = create_json_stats_for_arena();
+    ret["workers"] = create_json_stats_for_workers();
+    ret["pools"] = create_json_stats_for_pools();
+    ret["servers"] = create_json_stats_for_servers();
+    return ret;
+}
+
+json CSLSManager::create_json_stats_for_workers() {
+    json ret = json::array();
+    for (SLSWorkerSet &set : m_worker_sets) {
+        CSLSRoleList *list_role = set.list_role;
+        for (int i = 0; i < list_role->get_worker_count(); i++) {
+            json worker = json::object();
+            worker["worker"]    = i;
+            worker["server"]    = set.port; // 0: shared by the servers
+            worker["pool"]      = CSLSRoleList::get_pool_name(list_role->get_pool(i));
+            worker["roles"]     = list_role->get_role_count(i); // in the worker's epoll
+            worker["queued"]    = list_role->get_queued_count(i); // placed, not admitted yet
+            worker["load"]      = list_role->get_load(i); // permille of the loop time spent working
+            worker["loopLatencyUs"] = list_role->get_loop_time(i); // average of one loop pass
+            worker["maxLoopLatencyUs"] = list_role->get_max_loop_time(i);
+            worker["bytesPerSecond"] = list_role->get_bytes(i);
+            worker["migrations"] = list_role->get_migrated(i); // streams moved out
+            worker["overloaded"] = list_role->is_overloaded(i); // refuses new players
+            worker["refusedPlayers"] = list_role->get_refused(i);
+            worker["shedPlayers"] = list_role->get_shed(i);
+            worker["cpu"]       = list_role->get_cpu(i); // the cpu it last ran on
+            worker["node"]      = list_role->get_node(i);
+            ret.push_back(worker);
+        }
+    }
+    return ret;
+}
+
+json CSLSManager::create_json_stats_for_pools() {
+    json ret = json::array();
+    for (SLSWorkerSet &set : m_worker_sets) {
+        CSLSRoleList *list_role = set.list_role;
+        for (int pool = SLS_POOL_SHARED; pool <= SLS_POOL_EGRESS; pool++) {
+            int first, count;
+            list_role->get_pool_range(pool, first, count);
+            if (count <= 0 || list_role->get_pool(first) != pool)
+                continue;
+            int load = 0;
+            int max_load = 0;
+            int64_t bytes = 0;
+            for (int i = first; i < first + count; i++) {
+                load += list_role->get_load(i);
+                max_load = std::max(max_load, list_role->get_load(i));
+                bytes += list_role->get_bytes(i);
+            }
+            json item = json::object();
+            item["pool"]        = CSLSRoleList::get_pool_name(pool);
+            item["server"]      = set.port;
+            item["workers"]     = count;
+            item["load"]        = load / count; // average permille
+            item["maxLoad"]     = max_load;
+            item["bytesPerSecond"] = bytes;
+            ret.push_back(item);
+        }
+    }
+    return ret;
+}
+
+json CSLSManager::create_json_stats_for_servers() {
+    json ret = json::array();
+    for (SLSWorkerSet &set : m_worker_sets) {
+        CSLSRoleList *list_role = set.list_role;
+        int count = list_role->get_worker_count();
+        if (count <= 0)
+            continue;
+        int roles = 0;
+        int64_t loop_time = 0;
+        int max_loop_time = 0;
+        int64_t refused = 0;
+        int64_t shed = 0;
+        for (int i = 0; i < count; i++) {
+            roles += list_role->get_role_count(i);
+            refused += list_role->get_refused(i);
+            shed += list_role->get_shed(i);
+            loop_time += list_role->get_loop_time(i);
+            max_loop_time = std::max(max_loop_time, list_role->get_max_loop_time(i));
+        }
+        json item = json::object();
+        item["server"]      = set.port; // 0: the shared workers
+        item["workers"]     = count;
+        item["roles"]       = roles;
+        item["loopLatencyUs"] = loop_time / count; // average of the workers
+        item["maxLoopLatencyUs"] = max_loop_time;
+        item["refusedPlayers"] = refused;
+        item["shedPlayers"] = shed;
+        ret.push_back(item);
+    }
+    return ret;
+}
+
+json CSLSManager::create_json_stats_for_arena() {
+    json ret = json::object();
+    SLSArenaStat stat;
+    CSLSRingArena::get_instance()->get_stat(&stat);
+    ret["mappedBytes"]      = stat.mapped_bytes;
+    ret["hugepageBytes"]    = stat.hugepage_bytes;
+    ret["usedBytes"]        = stat.used_bytes;
+    ret["freeBytes"]        = stat.free_bytes;
+    ret["allocs"]           = stat.alloc_count;
+    ret["grows"]            = stat.grow_count; // blocks mapped on demand
+    ret["minorFaults"]      = stat.minor_faults; // of the process
+    ret["majorFaults"]      = stat.major_faults;
+    ret["nodeBytes"]        = json::array(); // mapped on each numa node
+    for (int i = 0; i < SLS_ARENA_MAX_NODES; i++)
+        ret["nodeBytes"].push_back(stat.node_bytes[i]);
     return ret;
 }
 
@@ -223,6 +441,12 @@ json CSLSManager::create_json_stats_for_publisher(CSLSRole *role, int clear) {
     ret["mbpsBandwidth"]    = stats.mbpsBandwidth;
     ret["bitrate"]          = role->get_bitrate(); // in kbps
     ret["uptime"]           = role->get_uptime(); // in seconds
+    int ring_size = 0;
+    int64_t ring_used = 0;
+    if (role->get_ring_info(ring_size, ring_used) == SLS_OK) {
+        ret["ringSize"]     = ring_size; // in bytes
+        ret["ringUsed"]     = ring_used; // in bytes
+    }
     return ret;
 }
 
@@ -296,14 +520,16 @@ int CSLSManager::stop()
         m_map_pusher = NULL;
     }
 
-    //release rolelist
-    if (m_list_role)
+    //release rolelists, the shared one and the ones of the servers
+    for (SLSWorkerSet &set : m_worker_sets)
     {
-        spdlog::info("[{}] CSLSManager::stop, release rolelist, size={:d}.", fmt::ptr(this), m_list_role->size());
-        m_list_role->erase();
-        delete m_list_role;
-        m_list_role = NULL;
+        spdlog::info("[{}] CSLSManager::stop, release rolelist, port={:d}, size={:d}.",
+                     fmt::ptr(this), set.port, set.list_role->size());
+        set.list_role->erase();
+        delete set.list_role;
     }
+    m_worker_sets.clear();
+    m_list_role = NULL;
     return ret;
 }
 
@@ -363,6 +589,73 @@ int CSLSManager::check_invalid()
     return SLS_ERROR;
 }
 
+//release the streams whose publisher didn't come back in the grace time.
+int CSLSManager::check_held_streams(int64_t cur_time_ms)
+{
+    int count = 0;
+    if (NULL == m_map_data)
+        return count;
+    for (int i = 0; i < m_server_count; i++)
+    {
+        count += m_map_data[i].check_held(cur_time_ms);
+    }
+    return count;
+}
+
+//move a stream from the busiest worker to the idlest one of each pool, one stream per interval.
+int CSLSManager::check_balance(int64_t cur_time_ms)
+{
+    if (m_balance_interval <= 0)
+        return SLS_OK;
+    if (cur_time_ms - m_balance_last_tm_ms < m_balance_interval)
+        return SLS_OK;
+    m_balance_last_tm_ms = cur_time_ms;
+
+    //streams never leave the workers of their server
+    for (SLSWorkerSet &set : m_worker_sets)
+    {
+        CSLSRoleList *list_role = set.list_role;
+        if (list_role->get_worker_count() < 2)
+            continue;
+        for (int pool = SLS_POOL_SHARED; pool <= SLS_POOL_EGRESS; pool++)
+        {
+            int first, count;
+            list_role->get_pool_range(pool, first, count);
+            if (count >= 2 && list_role->get_pool(first) == pool)
+            {
+                check_balance_pool(list_role, first, count);
+            }
+        }
+    }
+    return SLS_OK;
+}
+
+int CSLSManager::check_balance_pool(CSLSRoleList *list_role, int first, int count)
+{
+    int busiest = first;
+    int idlest = first;
+    for (int i = first + 1; i < first + count; i++)
+    {
+        if (list_role->get_load(i) > list_role->get_load(busiest))
+            busiest = i;
+        if (list_role->get_load(i) < list_role->get_load(idlest))
+            idlest = i;
+    }
+    int busy_load = list_role->get_load(busiest);
+    int idle_load = list_role->get_load(idlest);
+    if (busy_load - idle_load < m_balance_load)
+        return SLS_OK;
+
+    //the bytes which even the load of both workers out.
+    int64_t bytes = list_role->get_bytes(busiest);
+    if (bytes <= 0)
+        return SLS_OK;
+    bytes = bytes * (busy_load - idle_load) / (2 * busy_load);
+    spdlog::info("[{}] CSLSManager::check_balance, worker {:d}, load={:d} -> worker {:d}, load={:d}, move bytes={:d}/s.",
+                 fmt::ptr(this), busiest, busy_load, idlest, idle_load, bytes);
+    return list_role->request_migration(busiest, idlest, bytes);
+}
+
 std::string CSLSManager::get_stat_info()
 {
     json info_obj;
@@ -386,7 +679,8 @@ std::string CSLSManager::get_stat_info()
                     {"remote_ip", role_info.remote_ip},
                     {"remote_port", role_info.remote_port},
                     {"start_time", role_info.start_time},
-                    {"kbitrate", role_info.kbitrate}});
+                    {"kbitrate", role_info.kbitrate},
+                    {"overruns", role_info.overruns}});
             }
 
         }
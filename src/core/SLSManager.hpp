@@ -44,6 +44,8 @@ char log_file[URL_MAX_LEN];
 char log_level[URL_MAX_LEN];
 char pidfile[URL_MAX_LEN];
 int worker_threads;
+int ingest_threads;
+int ingest_priority;
 int worker_connections;
 char stat_post_url[URL_MAX_LEN];
 int stat_post_interval;
@@ -51,6 +53,18 @@ char record_hls_path_prefix[URL_MAX_LEN];
 int http_port;
 char cors_header[URL_MAX_LEN];
 std::vector<std::string> api_keys;
+char ring_lock_free[SHORT_STR_MAX_LEN];
+int ring_arena_size;
+char ring_hugepage[SHORT_STR_MAX_LEN];
+char ring_numa[SHORT_STR_MAX_LEN];
+char worker_cpus[URL_MAX_LEN];
+int worker_spin_time;
+int worker_spread_viewers;
+int worker_balance_interval;
+int worker_balance_load;
+int worker_overload_lag;
+int worker_overload_bitrate;
+int worker_overload_shed;
 SLS_CONF_DYNAMIC_DECLARE_END
 
 /**
@@ -61,6 +75,8 @@ SLS_SET_CONF(srt, string, log_file, "save log file name.", 1, URL_MAX_LEN - 1),
     SLS_SET_CONF(srt, string, log_level, "log level", 1, URL_MAX_LEN - 1),
     SLS_SET_CONF(srt, string, pidfile, "PID file path", 1, URL_MAX_LEN - 1),
     SLS_SET_CONF(srt, int, worker_threads, "count of worker thread, if 0, only main thread.", 0, 100),
+    SLS_SET_CONF(srt, int, ingest_threads, "count of extra worker threads for publishers, pullers and listeners, 0: shared workers.", 0, 100),
+    SLS_SET_CONF(srt, int, ingest_priority, "SCHED_RR priority of the ingest threads, 0: normal scheduling.", 0, 99),
     SLS_SET_CONF(srt, int, worker_connections, "", 1, 1024),
     SLS_SET_CONF(srt, string, stat_post_url, "statistic info post url", 1, URL_MAX_LEN - 1),
     SLS_SET_CONF(srt, int, stat_post_interval, "interval of statistic info post.", 1, 60),
@@ -68,9 +84,30 @@ SLS_SET_CONF(srt, string, log_file, "save log file name.", 1, URL_MAX_LEN - 1),
     SLS_SET_CONF(srt, int, http_port, "rest api port", 1, 65535),
     SLS_SET_CONF(srt, string, cors_header, "cors header", 1, URL_MAX_LEN - 1),
     SLS_SET_CONF(srt, string_list, api_keys, "comma-separated list of API keys for /stats endpoint", 0, 10240),
+    SLS_SET_CONF(srt, string, ring_lock_free, "lock free stream ring, on or off", 1, SHORT_STR_MAX_LEN - 1),
+    SLS_SET_CONF(srt, int, ring_arena_size, "preallocated stream ring memory, unit mbyte.", 0, 65536),
+    SLS_SET_CONF(srt, string, ring_hugepage, "back stream rings with huge pages, on or off", 1, SHORT_STR_MAX_LEN - 1),
+    SLS_SET_CONF(srt, string, ring_numa, "allocate stream rings on the numa node of their worker, on or off", 1, SHORT_STR_MAX_LEN - 1),
+    SLS_SET_CONF(srt, string, worker_cpus, "cpus which the workers are pinned to in turn, e.g. '0-3,8-11'.", 1, URL_MAX_LEN - 1),
+    SLS_SET_CONF(srt, int, worker_spin_time, "workers keep polling after the last work before they block, unit us.", 0, 100000),
+    SLS_SET_CONF(srt, int, worker_spread_viewers, "players of a stream beyond this count go to the least loaded worker, 0: never.", 0, 1000000),
+    SLS_SET_CONF(srt, int, worker_balance_interval, "interval of moving streams from the busiest worker to the idlest one, unit s, 0: never.", 0, 3600),
+    SLS_SET_CONF(srt, int, worker_balance_load, "busy permille of the busiest worker above the idlest one to move a stream.", 1, 1000),
+    SLS_SET_CONF(srt, int, worker_overload_lag, "average loop time which overloads a worker, it refuses new players, unit us, 0: no limit.", 0, 10000000),
+    SLS_SET_CONF(srt, int, worker_overload_bitrate, "bitrate which overloads a worker, unit mbps, 0: no limit.", 0, 100000),
+    SLS_SET_CONF(srt, int, worker_overload_shed, "players closed per second by a worker overloaded for more than 1s, 0: never.", 0, 10000),
     SLS_CONF_CMD_DYNAMIC_DECLARE_END
 
     /**
+ * SLSWorkerSet, the shared workers or the own workers of one server
+ */
+struct SLSWorkerSet
+{
+    CSLSRoleList *list_role;
+    int port; //listen port of the server, 0: the shared workers
+};
+
+/**
  * CSLSManager , manage players, publishers and listener
  */
     class CSLSManager
@@ -86,7 +123,13 @@ public:
     json generate_json_for_publisher(std::string publisherName, int clear);
     json generate_json_for_all_publishers(int clear);
     json create_json_stats_for_publisher(CSLSRole *role, int clear);
+    json create_json_stats_for_arena();
+    json create_json_stats_for_workers();
+    json create_json_stats_for_pools();
+    json create_json_stats_for_servers();
     int check_invalid();
+    int check_held_streams(int64_t cur_time_ms);
+    int check_balance(int64_t cur_time_ms);
     bool is_single_thread();
 
     std::string get_stat_info();
@@ -103,6 +146,15 @@ private:
     vector<CSLSGroup *> m_workers;
     int m_worker_threads;
 
-    CSLSRoleList *m_list_role;
+    CSLSRoleList *m_list_role;         //of the shared workers
+    vector<SLSWorkerSet> m_worker_sets; //the shared workers first
     CSLSGroup *m_single_group;
+
+    int start_workers(CSLSRoleList *list_role, int threads, int ingest_threads, sls_conf_srt_t *conf_srt,
+                      const std::vector<int> &worker_cpus, int &cpu_index);
+    int check_balance_pool(CSLSRoleList *list_role, int first, int count);
+
+    int m_balance_interval;       //ms
+    int m_balance_load;           //permille
+    int64_t m_balance_last_tm_ms;
 };
@@ -22,6 +22,7 @@
  * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
 #include <errno.h>
 #include <fcntl.h>
 #include <string.h>
@@ -31,264 +32,814 @@
 #include "SLSLog.hpp"
 
 /**
- * CSLSMapData class implementation
+ * CSLSStreamData class implementation
  */
 
-CSLSMapData::CSLSMapData()
+CSLSStreamData::CSLSStreamData(const char *key, const SLSRingConf *ring_conf, bool lock_free,
+                               const SLSTimeShiftConf *timeshift_conf)
 {
+    m_key = key;
+    m_ref = 1;
+    m_removed = false;
+    m_hold_until = 0;
+    m_discontinuity = 0;
+    m_discontinuity_pending = false;
+    m_ingest_owner = NULL;
+    m_ingest_time = 0;
+    m_switch_pending = false;
+    m_cc_track = false;
+    m_array_data.set_conf(ring_conf);
+    m_array_data.set_lock_free(lock_free);
+    m_timeshift = NULL;
+    if (timeshift_conf && timeshift_conf->duration > 0)
+    {
+        m_timeshift = new CSLSTimeShift(key, timeshift_conf, m_array_data.is_message_mode());
+    }
+
+    sls_init_ts_info(&m_ts_info);
+    m_ts_info.need_spspps = true;
+    m_ts_info_done = false;
 }
-CSLSMapData::~CSLSMapData()
+
+CSLSStreamData::~CSLSStreamData()
 {
-    clear();
+    if (m_timeshift)
+    {
+        delete m_timeshift;
+        m_timeshift = NULL;
+    }
 }
 
-int CSLSMapData::add(char *key)
+void CSLSStreamData::add_ref()
 {
-    int ret = SLS_OK;
-    std::string strKey = std::string(key);
+    m_ref.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CSLSStreamData::release()
+{
+    if (m_ref.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        spdlog::info("[{}] CSLSStreamData::release, key='{}', delete stream data.",
+                     fmt::ptr(this), m_key);
+        delete this;
+    }
+}
+
+//the publisher is gone, readers should attach to the new stream of the key.
+bool CSLSStreamData::is_removed()
+{
+    return m_removed.load(std::memory_order_relaxed);
+}
+
+void CSLSStreamData::set_removed()
+{
+    m_removed.store(true, std::memory_order_relaxed);
+    //the sleeping roles follow the key to its next stream.
+    notify_subscribers();
+}
+
+const char *CSLSStreamData::get_key()
+{
+    return m_key.c_str();
+}
+
+//the publisher is gone, keep the ring and the attached roles until hold_until.
+void CSLSStreamData::hold(int64_t hold_until)
+{
+    m_hold_until.store(hold_until);
+}
+
+//a publisher of the key is back, only one of resume and expire succeeds.
+bool CSLSStreamData::resume()
+{
+    int64_t hold_until = m_hold_until.load();
+    if (hold_until <= 0 || !m_hold_until.compare_exchange_strong(hold_until, 0))
+        return false;
+    m_discontinuity_pids.clear();
+    m_discontinuity_pending = true;
+    m_discontinuity.fetch_add(1);
+    return true;
+}
+
+bool CSLSStreamData::expire(int64_t cur_time_ms)
+{
+    int64_t hold_until = m_hold_until.load();
+    if (hold_until <= 0 || cur_time_ms < hold_until)
+        return false;
+    return m_hold_until.compare_exchange_strong(hold_until, -1);
+}
+
+bool CSLSStreamData::is_held()
+{
+    return m_hold_until.load(std::memory_order_relaxed) > 0;
+}
+
+bool CSLSStreamData::is_expired()
+{
+    return m_hold_until.load(std::memory_order_relaxed) < 0;
+}
+
+//only the owner writes the ring, a role takes it over when there is no owner
+//or the owner has not written anything for stall_timeout ms.
+bool CSLSStreamData::claim_ingest(const void *role, int stall_timeout, int64_t cur_time_ms)
+{
+    const void *owner = m_ingest_owner.load();
+    if (owner == role)
+        return true;
+    if (NULL != owner && (stall_timeout <= 0 || cur_time_ms - m_ingest_time.load() < stall_timeout))
+        return false;
+
+    CSLSLock lock(&m_ingest_mutex);
+    owner = m_ingest_owner.load();
+    if (NULL != owner && cur_time_ms - m_ingest_time.load() < stall_timeout)
+        return false;
+    m_ingest_owner.store(role);
+    m_ingest_time.store(cur_time_ms);
+    m_cc_track = stall_timeout > 0;
+    if (m_cc_track && m_last_cc.empty())
+    {
+        m_last_cc.assign(TS_PID_COUNT, -1);
+        m_cc_offset.assign(TS_PID_COUNT, 0);
+    }
+    //the data of the last owner is in the ring already.
+    m_switch_pending = m_array_data.count() > 0;
+    spdlog::info("[{}] CSLSStreamData::claim_ingest, key={}, owner {} -> {}, switch_pending={:d}.",
+                 fmt::ptr(this), m_key, fmt::ptr(owner), fmt::ptr(role), m_switch_pending);
+    return true;
+}
+
+bool CSLSStreamData::is_ingest_owner(const void *role)
+{
+    return m_ingest_owner.load() == role;
+}
+
+void CSLSStreamData::release_ingest(const void *role)
+{
+    CSLSLock lock(&m_ingest_mutex);
+    const void *owner = role;
+    m_ingest_owner.compare_exchange_strong(owner, NULL);
+}
+
+void CSLSStreamData::update_ingest_time(int64_t cur_time_ms)
+{
+    m_ingest_time.store(cur_time_ms, std::memory_order_relaxed);
+}
+
+//held by the owner while it writes the ring, so the ring is never taken over in between.
+CSLSMutex *CSLSStreamData::get_ingest_mutex()
+{
+    return &m_ingest_mutex;
+}
+
+int CSLSStreamData::put(char *data, int len, int64_t *last_read_time)
+{
+    char *buf = reserve(len);
+    if (NULL == buf)
+    {
+        return SLS_ERROR;
+    }
+    memcpy(buf, data, len);
+    return commit(buf, len, sls_gettime_ms(), last_read_time);
+}
+
+void CSLSStreamData::subscribe(SLSSubscriber *subscriber)
+{
+    CSLSLock lock(&m_subscriber_mutex);
+    if (std::find(m_subscribers.begin(), m_subscribers.end(), subscriber) == m_subscribers.end())
+    {
+        m_subscribers.push_back(subscriber);
+    }
+}
+
+//the subscriber is never signaled once this returns.
+void CSLSStreamData::unsubscribe(SLSSubscriber *subscriber)
+{
+    CSLSLock lock(&m_subscriber_mutex);
+    auto it = std::find(m_subscribers.begin(), m_subscribers.end(), subscriber);
+    if (it != m_subscribers.end())
+    {
+        *it = m_subscribers.back();
+        m_subscribers.pop_back();
+    }
+}
 
-    CSLSLock lock(&m_rwclock, true);
+int CSLSStreamData::get_subscriber_count()
+{
+    CSLSLock lock(&m_subscriber_mutex);
+    return m_subscribers.size();
+}
 
-    std::map<std::string, CSLSRecycleArray *>::iterator item;
-    item = m_map_array.find(strKey);
-    if (item != m_map_array.end())
+//wake the workers of the sleeping roles, each role is queued once until it is serviced.
+void CSLSStreamData::notify_subscribers()
+{
+    CSLSLock lock(&m_subscriber_mutex);
+    for (SLSSubscriber *subscriber : m_subscribers)
     {
-        CSLSRecycleArray *array_data = item->second;
-        if (array_data)
+        if (!subscriber->pending.exchange(true))
         {
-            spdlog::info("[{}] CSLSMapData::add, failed, key={}, array_data={}, exist.",
-                         fmt::ptr(this), key, fmt::ptr(array_data));
-            return ret;
+            subscriber->queue->push(subscriber->fd);
         }
-        // m_map_array.erase(item);
     }
+}
 
-    CSLSRecycleArray *data_array = new CSLSRecycleArray;
-    // m_map_array.insert(make_pair(strKey, data_array));
-    m_map_array[strKey] = data_array;
-    spdlog::info("[{}] CSLSMapData::add ok, key='{}'.",
-                 fmt::ptr(this), key);
-    return ret;
+//only called by the publisher, receive into the returned space then commit it.
+char *CSLSStreamData::reserve(int len, int *avail)
+{
+    return m_array_data.reserve(len, avail);
 }
 
-int CSLSMapData::remove(char *key)
+//cur_time_ms is read once per ingest batch by the publisher.
+int CSLSStreamData::commit(char *data, int len, int64_t cur_time_ms, int64_t *last_read_time)
 {
-    int ret = SLS_ERROR;
-    std::string strKey = std::string(key);
+    int ret = SLS_OK;
 
-    CSLSLock lock(&m_rwclock, true);
+    int keyframe_pos = -1;
+    if (m_array_data.is_message_mode())
+    {
+        //the data is a list of length prefixed messages.
+        for (int pos = 0; pos + SLS_MSG_HEADER_LEN <= len;)
+        {
+            int msg_len = sls_get_msg_len(data + pos);
+            if (pos + SLS_MSG_HEADER_LEN + msg_len > len)
+            {
+                spdlog::error("[{}] CSLSStreamData::commit, key={}, bad message, pos={:d}, msg_len={:d}, len={:d}.",
+                              fmt::ptr(this), m_key, pos, msg_len, len);
+                m_array_data.commit(0);
+                return SLS_ERROR;
+            }
+            //the keyframe starts with its message, readers never get a partial message.
+            if (find_keyframe(data + pos + SLS_MSG_HEADER_LEN, msg_len) >= 0 && keyframe_pos < 0)
+            {
+                keyframe_pos = pos;
+            }
+            pos += SLS_MSG_HEADER_LEN + msg_len;
+        }
+    }
+    else
+    {
+        keyframe_pos = find_keyframe(data, len);
+    }
 
-    std::map<std::string, ts_info *>::iterator item_ti;
-    item_ti = m_map_ts_info.find(strKey);
-    if (item_ti != m_map_ts_info.end())
+    if (m_switch_pending)
     {
-        ts_info *ti = item_ti->second;
-        if (ti)
+        //the ring goes on with another publisher, from its first keyframe.
+        if (keyframe_pos < 0)
         {
-            delete ti;
+            m_array_data.commit(0);
+            return 0;
         }
-        m_map_ts_info.erase(item_ti);
+        len -= keyframe_pos;
+        memmove(data, data + keyframe_pos, len);
+        keyframe_pos = 0;
+        m_switch_pending = false;
+        std::fill(m_cc_offset.begin(), m_cc_offset.end(), -1);
+        m_discontinuity_pids.clear();
+        m_discontinuity_pending = true;
+        m_discontinuity.fetch_add(1);
+        spdlog::info("[{}] CSLSStreamData::commit, key={}, switched to the new publisher at a keyframe.",
+                     fmt::ptr(this), m_key);
+    }
+
+    if (m_cc_track)
+    {
+        fix_cc(data, len);
+    }
+
+    if (m_discontinuity_pending.load(std::memory_order_relaxed))
+    {
+        mark_discontinuity(data, len, keyframe_pos);
     }
 
-    std::map<std::string, CSLSRecycleArray *>::iterator item;
-    item = m_map_array.find(strKey);
-    if (item != m_map_array.end())
+    ret = m_array_data.commit(len, keyframe_pos, cur_time_ms);
+    if (ret != len)
     {
-        CSLSRecycleArray *array_data = item->second;
-        spdlog::info("[{}] CSLSMapData::remove, key='{}' delete array_data={}.",
-                     fmt::ptr(this), key, fmt::ptr(array_data));
-        if (array_data)
+        spdlog::error("[{}] CSLSStreamData::commit, key={}, m_array_data.commit failed, len={:d}, but ret={:d}.",
+                      fmt::ptr(this), m_key, len, ret);
+    }
+    else
+    {
+        if (m_timeshift)
         {
-            delete array_data;
+            m_timeshift->write(data, len, keyframe_pos, cur_time_ms);
         }
-        m_map_array.erase(item);
-        return SLS_OK;
+        notify_subscribers();
     }
+    if (NULL != last_read_time)
+    {
+        *last_read_time = m_array_data.get_last_read_time();
+    }
+
     return ret;
 }
 
-bool CSLSMapData::is_exist(char *key)
+//check sps and pps first, return the keyframe pos in data or -1.
+int CSLSStreamData::find_keyframe(char *data, int len)
 {
+    if (!m_ts_info_done)
+    {
+        CSLSLock lock(&m_ts_info_mutex);
+        if (SLS_OK == check_ts_info(data, len, &m_ts_info))
+        {
+            m_ts_info_done = true;
+            spdlog::info("[{}] CSLSStreamData::commit, check_spspps ok, key={}.",
+                         fmt::ptr(this), m_key);
+        }
+    }
+    return sls_find_keyframe((const uint8_t *)data, len, &m_ts_info);
+}
 
-    CSLSLock lock(&m_rwclock, true);
-    std::string strKey = std::string(key);
-
-    std::map<std::string, CSLSRecycleArray *>::iterator item;
-    item = m_map_array.find(key);
-    if (item != m_map_array.end())
+//only called by the publisher, mark the data of a resumed publisher
+//until its first keyframe, the counters and timestamps restart there.
+void CSLSStreamData::mark_discontinuity(char *data, int len, int keyframe_pos)
+{
+    if (m_array_data.is_message_mode())
     {
-        CSLSRecycleArray *array_data = item->second;
-        if (array_data)
+        for (int pos = 0; pos + SLS_MSG_HEADER_LEN <= len;)
         {
-            spdlog::trace("[{}] CSLSMapData::is_exist, key={}, exist.",
-                          fmt::ptr(this), key);
-            return true;
+            int msg_len = sls_get_msg_len(data + pos);
+            sls_set_ts_discontinuity((uint8_t *)data + pos + SLS_MSG_HEADER_LEN, msg_len, m_discontinuity_pids);
+            pos += SLS_MSG_HEADER_LEN + msg_len;
         }
-        else
+    }
+    else
+    {
+        sls_set_ts_discontinuity((uint8_t *)data, len, m_discontinuity_pids);
+    }
+    if (keyframe_pos >= 0)
+    {
+        m_discontinuity_pending = false;
+        spdlog::info("[{}] CSLSStreamData::mark_discontinuity, key={}, marked pids={:d}.",
+                     fmt::ptr(this), m_key, m_discontinuity_pids.size());
+    }
+}
+
+//only called by the publisher, keep the continuity counters across the owners.
+void CSLSStreamData::fix_cc(char *data, int len)
+{
+    if (m_array_data.is_message_mode())
+    {
+        for (int pos = 0; pos + SLS_MSG_HEADER_LEN <= len;)
         {
-            spdlog::trace("[{}] CSLSMapData::is_exist, is_exist, key={}, data_array is null.",
-                          fmt::ptr(this), key);
+            int msg_len = sls_get_msg_len(data + pos);
+            sls_fix_ts_cc((uint8_t *)data + pos + SLS_MSG_HEADER_LEN, msg_len, m_last_cc.data(), m_cc_offset.data());
+            pos += SLS_MSG_HEADER_LEN + msg_len;
         }
     }
     else
     {
-        spdlog::trace("[{}] CSLSMapData::add, is_exist, key={}, not exist.",
-                      fmt::ptr(this), key);
+        sls_fix_ts_cc((uint8_t *)data, len, m_last_cc.data(), m_cc_offset.data());
     }
-    return false;
 }
 
-int CSLSMapData::put(char *key, char *data, int len, int64_t *last_read_time)
+int CSLSStreamData::get(SLSChunkView *views, int &view_count, SLSRecycleArrayID *read_id, int aligned)
 {
     int ret = SLS_OK;
+    int max_view_count = view_count;
+    view_count = 0;
 
-    CSLSLock lock(&m_rwclock, true);
-    std::string strKey = std::string(key);
-
-    std::map<std::string, CSLSRecycleArray *>::iterator item;
-    item = m_map_array.find(strKey);
-    if (item == m_map_array.end())
+    int64_t overrun = read_id->nOverrun;
+    int64_t discontinuity = m_discontinuity.load(std::memory_order_relaxed);
+    if (read_id->bFirst)
     {
-        spdlog::error("[{}] CSLSMapData::put, key={}, not found data array.",
-                      fmt::ptr(this), key);
-        return SLS_ERROR;
+        read_id->nDiscontinuity = discontinuity;
     }
-    CSLSRecycleArray *array_data = item->second;
-    if (NULL == array_data)
+    int ts_info_len = 0;
+    if (read_id->bFirst && max_view_count > 1)
     {
-        spdlog::error("[{}] CSLSMapData::get, key={}, array_data is NULL.",
-                      fmt::ptr(this), key);
+        // get sps and pps, the data follows from the last keyframe or the write pos
+        ts_info_len = get_ts_info(views);
+        spdlog::info("[{}] CSLSStreamData::get, get sps pps ok, key={}, len={:d}, keyframe_start={:d}.",
+                     fmt::ptr(this), m_key, ts_info_len, read_id->bKeyFrameStart);
+    }
+    int ts_info_count = ts_info_len > 0 ? 1 : 0;
+    // keep a view for the sps and pps which didn't fit in the last call
+    int pending_count = (0 == ts_info_count && read_id->bTsInfoPending && max_view_count > 1) ? 1 : 0;
+    view_count = max_view_count - ts_info_count - pending_count;
+    ret = m_array_data.get(views + ts_info_count, view_count, read_id, aligned);
+    if (ts_info_count > 0)
+    {
+        read_id->bTsInfoPending = false;
+        if (ret < 0)
+        {
+            CSLSRecycleArray::release_views(views, ts_info_count);
+            view_count = 0;
+            return ret;
+        }
+        view_count += ts_info_count;
+        ret += ts_info_len;
+        return ret;
     }
 
-    ret = array_data->put(data, len);
-    if (ret != len)
+    if (overrun != read_id->nOverrun || discontinuity != read_id->nDiscontinuity)
     {
-        spdlog::error("[{}] CSLSMapData::put, key={}, array_data->put failed, len={:d}, but ret={:d}.",
-                      fmt::ptr(this), key, len, ret);
+        // the reader is moved to a keyframe or the publisher resumed, let the decoder get sps and pps again
+        read_id->nDiscontinuity = discontinuity;
+        read_id->bTsInfoPending = true;
     }
-    if (NULL != last_read_time)
+    if (read_id->bTsInfoPending && ret > 0 && view_count < max_view_count)
+    {
+        read_id->bTsInfoPending = false;
+        memmove(views + 1, views, sizeof(SLSChunkView) * view_count);
+        int len = get_ts_info(views);
+        if (len > 0)
+        {
+            view_count++;
+            ret += len;
+        }
+        else
+        {
+            memmove(views, views + 1, sizeof(SLSChunkView) * view_count);
+        }
+    }
+    return ret;
+}
+
+//a time shifted player gets the data at the pace it was written, from its offset behind the live edge.
+int CSLSStreamData::get_shifted(SLSChunkView *views, int &view_count, SLSTimeShiftID *read_id)
+{
+    int max_view_count = view_count;
+    view_count = 0;
+    if (NULL == m_timeshift || max_view_count < 2)
     {
-        *last_read_time = array_data->get_last_read_time();
+        return SLS_ERROR;
     }
 
-    // check sps and pps
-    ts_info *ti = NULL;
-    std::map<std::string, ts_info *>::iterator item_ti;
-    item_ti = m_map_ts_info.find(strKey);
-    if (item_ti == m_map_ts_info.end())
+    view_count = max_view_count - 1;
+    int ret = m_timeshift->get(views + 1, view_count, read_id, sls_gettime_ms());
+    if (ret <= 0)
+    {
+        CSLSRecycleArray::release_views(views + 1, view_count);
+        view_count = 0;
+        return ret;
+    }
+    //each jump starts at a keyframe, let the decoder get sps and pps first.
+    int ts_info_len = read_id->bFirst ? get_ts_info(views) : 0;
+    read_id->bFirst = false;
+    if (ts_info_len > 0)
     {
-        ti = new ts_info;
-        sls_init_ts_info(ti);
-        ti->need_spspps = true;
-        m_map_ts_info[strKey] = ti;
+        view_count++;
+        ret += ts_info_len;
     }
     else
     {
-        ti = item_ti->second;
+        memmove(views, views + 1, sizeof(SLSChunkView) * view_count);
     }
+    return ret;
+}
+
+bool CSLSStreamData::has_timeshift()
+{
+    return NULL != m_timeshift;
+}
 
-    if (SLS_OK == check_ts_info(data, len, ti))
+int CSLSStreamData::get_ts_info(char *data, int len)
+{
+    if (len < TS_UDP_LEN)
+    {
+        return 0;
+    }
+    CSLSLock lock(&m_ts_info_mutex);
+    memcpy(data, m_ts_info.ts_data, TS_UDP_LEN);
+    // pat and pmt are always ahead, even if sps and pps are unknown
+    if (m_ts_info.pat_len > 0 && m_ts_info.pmt_len > 0)
     {
-        spdlog::info("[{}] CSLSMapData::put, check_spspps ok, key={}.",
-                     fmt::ptr(this), key);
+        memcpy(data, m_ts_info.pat, TS_PACK_LEN);
+        memcpy(data + TS_PACK_LEN, m_ts_info.pmt, TS_PACK_LEN);
     }
+    return TS_UDP_LEN;
+}
 
+int CSLSStreamData::get_ts_info(SLSChunkView *view)
+{
+    SLSChunk *chunk = CSLSRecycleArray::alloc_chunk(SLS_MSG_HEADER_LEN + TS_UDP_LEN);
+    int header_len = m_array_data.is_message_mode() ? SLS_MSG_HEADER_LEN : 0;
+    int ret = get_ts_info(chunk->data + header_len, TS_UDP_LEN);
+    if (ret <= 0)
+    {
+        CSLSRecycleArray::release_chunk(chunk);
+        return ret;
+    }
+    if (header_len > 0)
+    {
+        //sent as one message like the ring data.
+        sls_set_msg_len(chunk->data, ret);
+        ret += header_len;
+    }
+    chunk->len = ret;
+    view->chunk = chunk;
+    view->offset = 0;
+    view->len = ret;
     return ret;
 }
 
-int CSLSMapData::get(char *key, char *data, int len, SLSRecycleArrayID *read_id, int aligned)
+bool CSLSStreamData::is_message_mode()
 {
-    int ret = SLS_OK;
+    return m_array_data.is_message_mode();
+}
 
-    CSLSLock lock(&m_rwclock, false);
-    std::string strKey = std::string(key);
+//only called by the publisher.
+void CSLSStreamData::adapt_ring_size(int kbitrate)
+{
+    m_array_data.adapt_size(kbitrate);
+}
 
-    std::map<std::string, CSLSRecycleArray *>::iterator item;
-    item = m_map_array.find(strKey);
-    if (item == m_map_array.end())
+int CSLSStreamData::get_ring_info(int &size, int64_t &used)
+{
+    size = m_array_data.get_size();
+    used = m_array_data.get_used();
+    return SLS_OK;
+}
+
+int CSLSStreamData::check_ts_info(char *data, int len, ts_info *ti)
+{
+    // only get the first, suppose the sps and pps are not changed always.
+    for (int i = 0; i < len;)
     {
-        spdlog::trace("[{}] CSLSMapData::get, key={}, not found data array,",
-                      fmt::ptr(this), key);
-        return SLS_ERROR;
+        if (ti->sps_len > 0 && ti->pps_len > 0 && ti->pat_len > 0 && ti->pmt_len > 0)
+        {
+            return SLS_OK;
+        }
+        sls_parse_ts_info((const uint8_t *)data + i, ti);
+        i += TS_PACK_LEN;
     }
-    CSLSRecycleArray *array_data = item->second;
-    if (NULL == array_data)
+
+    return SLS_ERROR;
+}
+
+/**
+ * CSLSMapData class implementation
+ */
+
+CSLSMapData::CSLSMapData()
+{
+    m_ring_lock_free = false;
+    m_held_count = 0;
+}
+CSLSMapData::~CSLSMapData()
+{
+    clear();
+}
+
+int CSLSMapData::add(char *key, const SLSRingConf *ring_conf, const SLSTimeShiftConf *timeshift_conf)
+{
+    int ret = SLS_OK;
+    std::string strKey = std::string(key);
+
+    CSLSStreamData *stream_data = acquire(key);
+    if (stream_data)
     {
-        spdlog::warn("[{}] CSLSMapData::get, key={}, array_data is NULL.",
-                     fmt::ptr(this), key);
-        return SLS_ERROR;
+        if (stream_data->resume())
+        {
+            spdlog::info("[{}] CSLSMapData::add, key={}, stream_data={}, resumed in the grace time.",
+                         fmt::ptr(this), key, fmt::ptr(stream_data));
+            stream_data->release();
+            notify_waiters(strKey);
+            return ret;
+        }
+        if (!stream_data->is_expired())
+        {
+            spdlog::info("[{}] CSLSMapData::add, failed, key={}, stream_data={}, exist.",
+                         fmt::ptr(this), key, fmt::ptr(stream_data));
+            stream_data->release();
+            return ret;
+        }
+        //the grace time is over, replace it by a new one.
+        if (m_map_stream.erase_if(strKey, stream_data))
+        {
+            stream_data->set_removed();
+            stream_data->release();
+        }
+        stream_data->release();
     }
 
-    bool b_first = read_id->bFirst;
-    ret = array_data->get(data, len, read_id, aligned);
-    if (b_first)
+    stream_data = new CSLSStreamData(key, ring_conf, m_ring_lock_free, timeshift_conf);
+    CSLSStreamData *cur_stream_data = NULL;
+    if (!m_map_stream.insert(strKey, stream_data, &cur_stream_data))
     {
-        // get sps and pps
-        ret = get_ts_info(key, data, len);
-        spdlog::info("[{}] CSLSMapData::get, get sps pps ok, key={}, len={:d}.",
-                     fmt::ptr(this), key, ret);
+        spdlog::info("[{}] CSLSMapData::add, failed, key={}, stream_data={}, exist.",
+                     fmt::ptr(this), key, fmt::ptr(cur_stream_data));
+        stream_data->release();
+        return ret;
     }
+    spdlog::info("[{}] CSLSMapData::add ok, key='{}'.",
+                 fmt::ptr(this), key);
+    notify_waiters(strKey);
     return ret;
 }
 
-int CSLSMapData::get_ts_info(char *key, char *data, int len)
+int CSLSMapData::remove(char *key)
 {
-    int ret = 0;
-    ts_info *ti = NULL;
-    std::string strKey = std::string(key);
-    std::map<std::string, ts_info *>::iterator item_ti;
-    item_ti = m_map_ts_info.find(strKey);
-    if (item_ti != m_map_ts_info.end())
+    CSLSStreamData *stream_data = NULL;
+    if (!m_map_stream.erase(std::string(key), &stream_data))
     {
-        ti = item_ti->second;
-        if (len >= TS_UDP_LEN)
+        return SLS_ERROR;
+    }
+    spdlog::info("[{}] CSLSMapData::remove, key='{}' release stream_data={}.",
+                 fmt::ptr(this), key, fmt::ptr(stream_data));
+    if (stream_data)
+    {
+        //the roles still attached keep it until they release it.
+        stream_data->set_removed();
+        stream_data->release();
+    }
+    return SLS_OK;
+}
+
+//keep the stream of a gone publisher for grace_ms, remove it at once if grace_ms is 0.
+int CSLSMapData::hold(char *key, int grace_ms)
+{
+    if (grace_ms <= 0)
+    {
+        return remove(key);
+    }
+    int64_t hold_until = sls_gettime_ms() + grace_ms;
+    bool held = m_map_stream.visit(std::string(key), [hold_until](CSLSStreamData *&item) {
+        if (item)
         {
-            memcpy(data, ti->ts_data, TS_UDP_LEN);
-            ret = TS_UDP_LEN;
+            item->hold(hold_until);
         }
+    });
+    if (!held)
+    {
+        return SLS_ERROR;
     }
-    return ret;
+    {
+        CSLSLock lock(&m_held_mutex);
+        m_held_keys[std::string(key)] = hold_until;
+        m_held_count.store(m_held_keys.size());
+    }
+    spdlog::info("[{}] CSLSMapData::hold, key='{}', grace={:d}ms.",
+                 fmt::ptr(this), key, grace_ms);
+    return SLS_OK;
 }
 
-void CSLSMapData::clear()
+//remove the held streams whose publisher didn't come back in time, return the count.
+int CSLSMapData::check_held(int64_t cur_time_ms)
 {
-    CSLSLock lock(&m_rwclock, true);
-    std::map<std::string, CSLSRecycleArray *>::iterator it;
-    for (it = m_map_array.begin(); it != m_map_array.end();)
+    if (0 == m_held_count.load(std::memory_order_relaxed))
+        return 0;
+
+    std::vector<std::string> due;
     {
-        CSLSRecycleArray *array_data = it->second;
-        if (array_data)
+        CSLSLock lock(&m_held_mutex);
+        std::map<std::string, int64_t>::iterator it = m_held_keys.begin();
+        while (it != m_held_keys.end())
         {
-            delete array_data;
+            if (cur_time_ms < it->second)
+            {
+                it++;
+                continue;
+            }
+            due.push_back(it->first);
+            it = m_held_keys.erase(it);
         }
-        it++;
+        m_held_count.store(m_held_keys.size());
     }
-    m_map_array.clear();
-    std::map<std::string, ts_info *>::iterator item_ti;
-    for (item_ti = m_map_ts_info.begin(); item_ti != m_map_ts_info.end();)
+
+    //a stream which was resumed in the meantime doesn't expire.
+    std::vector<std::pair<std::string, CSLSStreamData *>> expired;
+    for (size_t i = 0; i < due.size(); i++)
     {
-        ts_info *ti = item_ti->second;
-        if (ti)
+        CSLSStreamData *stream_data = acquire((char *)due[i].c_str());
+        if (NULL == stream_data)
+            continue;
+        if (!stream_data->expire(cur_time_ms))
         {
-            delete ti;
+            stream_data->release();
+            continue;
         }
-        item_ti++;
+        expired.push_back(std::make_pair(due[i], stream_data));
     }
-    m_map_ts_info.clear();
+
+    for (size_t i = 0; i < expired.size(); i++)
+    {
+        CSLSStreamData *stream_data = expired[i].second;
+        if (m_map_stream.erase_if(expired[i].first, stream_data))
+        {
+            spdlog::info("[{}] CSLSMapData::check_held, key='{}', no publisher in the grace time, release stream_data={}.",
+                         fmt::ptr(this), expired[i].first, fmt::ptr(stream_data));
+            stream_data->set_removed();
+            stream_data->release();
+        }
+        stream_data->release();
+    }
+    return expired.size();
 }
 
-int CSLSMapData::check_ts_info(char *data, int len, ts_info *ti)
+//return a referenced stream data, the caller must release it.
+CSLSStreamData *CSLSMapData::acquire(char *key)
 {
-    // only get the first, suppose the sps and pps are not changed always.
-    for (int i = 0; i < len;)
+    CSLSStreamData *stream_data = NULL;
+    m_map_stream.visit(std::string(key), [&stream_data](CSLSStreamData *&item) {
+        if (item)
+        {
+            item->add_ref();
+            stream_data = item;
+        }
+    });
+    if (NULL == stream_data)
+    {
+        spdlog::trace("[{}] CSLSMapData::acquire, key={}, not found stream data.",
+                      fmt::ptr(this), key);
+    }
+    return stream_data;
+}
+
+//the subscriber is signaled through its ready queue when a publisher of the key appears.
+void CSLSMapData::wait(char *key, SLSSubscriber *subscriber)
+{
+    CSLSLock lock(&m_waiter_mutex);
+    std::vector<SLSSubscriber *> &waiters = m_waiters[std::string(key)];
+    if (std::find(waiters.begin(), waiters.end(), subscriber) == waiters.end())
+    {
+        waiters.push_back(subscriber);
+    }
+}
+
+//the subscriber is never signaled once this returns.
+void CSLSMapData::unwait(char *key, SLSSubscriber *subscriber)
+{
+    CSLSLock lock(&m_waiter_mutex);
+    std::map<std::string, std::vector<SLSSubscriber *>>::iterator it = m_waiters.find(std::string(key));
+    if (it == m_waiters.end())
+        return;
+    std::vector<SLSSubscriber *> &waiters = it->second;
+    std::vector<SLSSubscriber *>::iterator pos = std::find(waiters.begin(), waiters.end(), subscriber);
+    if (pos != waiters.end())
     {
-        if (ti->sps_len > 0 && ti->pps_len > 0 && ti->pat_len > 0 && ti->pat_len > 0)
+        *pos = waiters.back();
+        waiters.pop_back();
+    }
+    if (waiters.empty())
+    {
+        m_waiters.erase(it);
+    }
+}
+
+//wake the workers of the parked players, they attach the stream and unwait.
+void CSLSMapData::notify_waiters(const std::string &key)
+{
+    CSLSLock lock(&m_waiter_mutex);
+    std::map<std::string, std::vector<SLSSubscriber *>>::iterator it = m_waiters.find(key);
+    if (it == m_waiters.end())
+        return;
+    for (SLSSubscriber *subscriber : it->second)
+    {
+        if (subscriber->queue && !subscriber->pending.exchange(true))
         {
-            break;
+            subscriber->queue->push(subscriber->fd);
         }
-        sls_parse_ts_info((const uint8_t *)data + i, ti);
-        i += TS_PACK_LEN;
     }
+}
 
-    return SLS_ERROR;
+void CSLSMapData::set_ring_lock_free(bool lock_free)
+{
+    m_ring_lock_free = lock_free;
+}
+
+int CSLSMapData::get_ring_info(char *key, int &size, int64_t &used)
+{
+    int ret = SLS_ERROR;
+    m_map_stream.visit(std::string(key), [&](CSLSStreamData *&item) {
+        if (item)
+        {
+            ret = item->get_ring_info(size, used);
+        }
+    });
+    return ret;
+}
+
+bool CSLSMapData::is_exist(char *key)
+{
+    CSLSStreamData *stream_data = NULL;
+    if (m_map_stream.find(std::string(key), stream_data) && stream_data)
+    {
+        spdlog::trace("[{}] CSLSMapData::is_exist, key={}, exist.",
+                      fmt::ptr(this), key);
+        return true;
+    }
+    spdlog::trace("[{}] CSLSMapData::is_exist, key={}, not exist.",
+                  fmt::ptr(this), key);
+    return false;
+}
+
+void CSLSMapData::clear()
+{
+    {
+        CSLSLock lock(&m_held_mutex);
+        m_held_keys.clear();
+        m_held_count.store(0);
+    }
+    std::map<std::string, CSLSStreamData *> items;
+    m_map_stream.clear(&items);
+    std::map<std::string, CSLSStreamData *>::iterator it;
+    for (it = items.begin(); it != items.end(); it++)
+    {
+        CSLSStreamData *stream_data = it->second;
+        if (stream_data)
+        {
+            stream_data->set_removed();
+            stream_data->release();
+        }
+    }
 }
@@ -24,11 +24,113 @@
 
 #pragma once
 
+#include <atomic>
 #include <map>
 #include <string>
+#include <vector>
 
 #include "SLSRecycleArray.hpp"
 #include "SLSLock.hpp"
+#include "SLSShardedMap.hpp"
+#include "SLSTimeShift.hpp"
+#include "SLSReadyQueue.hpp"
+
+/**
+ * SLSSubscriber, a role which sleeps until its stream has new data,
+ * its worker is signaled once through the ready queue until it is serviced.
+ */
+struct SLSSubscriber
+{
+    int fd;
+    CSLSReadyQueue *queue;
+    std::atomic<bool> pending;
+};
+
+/**
+ * CSLSStreamData, the ring and ts info of one stream.
+ * referenced by CSLSMapData while the stream exists and by each attached role,
+ * it is deleted with the last reference, so a role never reads a deleted ring.
+ * when the publisher is gone the stream may be held for a grace time,
+ * a publisher of the same key resumes into the same ring in the meantime.
+ * with a time shift buffer, players may also join behind the live edge.
+ */
+class CSLSStreamData
+{
+public:
+    CSLSStreamData(const char *key, const SLSRingConf *ring_conf, bool lock_free,
+                   const SLSTimeShiftConf *timeshift_conf = NULL);
+
+    void add_ref();
+    void release();
+    bool is_removed();
+    void set_removed();
+    const char *get_key();
+
+    void subscribe(SLSSubscriber *subscriber);
+    void unsubscribe(SLSSubscriber *subscriber);
+    int get_subscriber_count();
+
+    void hold(int64_t hold_until);
+    bool resume();
+    bool expire(int64_t cur_time_ms);
+    bool is_held();
+    bool is_expired();
+
+    bool claim_ingest(const void *role, int stall_timeout, int64_t cur_time_ms);
+    bool is_ingest_owner(const void *role);
+    void release_ingest(const void *role);
+    void update_ingest_time(int64_t cur_time_ms);
+    CSLSMutex *get_ingest_mutex();
+
+    char *reserve(int len, int *avail = NULL);
+    int commit(char *data, int len, int64_t cur_time_ms, int64_t *last_read_time = NULL);
+    int put(char *data, int len, int64_t *last_read_time = NULL);
+    int get(SLSChunkView *views, int &view_count, SLSRecycleArrayID *read_id, int aligned = 0);
+    int get_shifted(SLSChunkView *views, int &view_count, SLSTimeShiftID *read_id);
+    bool has_timeshift();
+
+    int get_ts_info(char *data, int len);
+    bool is_message_mode();
+    void adapt_ring_size(int kbitrate);
+    int get_ring_info(int &size, int64_t &used);
+
+private:
+    ~CSLSStreamData();
+
+    std::string m_key;
+    CSLSRecycleArray m_array_data;
+    CSLSTimeShift *m_timeshift; //NULL: no time shift
+    std::atomic<int> m_ref;
+    std::atomic<bool> m_removed;
+    std::atomic<int64_t> m_hold_until; //0: published, -1: expired, else held until this time
+
+    std::atomic<int64_t> m_discontinuity;        //times a publisher resumed
+    std::atomic<bool> m_discontinuity_pending;   //the next data of the publisher is marked
+    std::vector<int> m_discontinuity_pids;       //only touched by the publisher
+
+    //the publisher which writes the ring, a standby one takes it over when it stalls.
+    std::atomic<const void *> m_ingest_owner;
+    std::atomic<int64_t> m_ingest_time;
+    CSLSMutex m_ingest_mutex;
+    bool m_switch_pending;             //the new owner starts at its first keyframe
+    bool m_cc_track;                   //continuity counters are kept across owners
+    std::vector<int8_t> m_last_cc;
+    std::vector<int8_t> m_cc_offset;
+
+    std::vector<SLSSubscriber *> m_subscribers;
+    CSLSMutex m_subscriber_mutex;
+
+    ts_info m_ts_info;
+    bool m_ts_info_done; //only touched by the publisher
+    CSLSMutex m_ts_info_mutex;
+
+    int check_ts_info(char *data, int len, ts_info *ti);
+    int find_keyframe(char *data, int len);
+    void mark_discontinuity(char *data, int len, int keyframe_pos);
+    void fix_cc(char *data, int len);
+    void notify_subscribers();
+    int get_ts_info(SLSChunkView *view);
+};
 
 class CSLSMapData
 {
@@ -36,21 +138,32 @@ public:
     CSLSMapData();
     virtual ~CSLSMapData();
 
-    int add(char *key);
+    int add(char *key, const SLSRingConf *ring_conf = NULL, const SLSTimeShiftConf *timeshift_conf = NULL);
     int remove(char *key);
+    int hold(char *key, int grace_ms);
+    int check_held(int64_t cur_time_ms);
     void clear();
 
-    int put(char *key, char *data, int len, int64_t *last_read_time = NULL);
-    int get(char *key, char *data, int len, SLSRecycleArrayID *read_id, int aligned = 0);
+    CSLSStreamData *acquire(char *key);
+    void wait(char *key, SLSSubscriber *subscriber);
+    void unwait(char *key, SLSSubscriber *subscriber);
 
     bool is_exist(char *key);
-
-    int get_ts_info(char *key, char *data, int len);
+    void set_ring_lock_free(bool lock_free);
+    int get_ring_info(char *key, int &size, int64_t &used);
 
 private:
-    std::map<std::string, CSLSRecycleArray *> m_map_array; //uplive_key_stream:data'
-    std::map<std::string, ts_info *> m_map_ts_info;        //uplive_key_stream:ts_info'
-    CSLSRWLock m_rwclock;
+    CSLSShardedMap<std::string, CSLSStreamData *> m_map_stream; //uplive_key_stream:stream data'
+    bool m_ring_lock_free;
 
-    int check_ts_info(char *data, int len, ts_info *ti);
+    //only the held keys are checked for expiry, not the whole registry.
+    std::map<std::string, int64_t> m_held_keys; //key:hold until
+    std::atomic<int> m_held_count;
+    CSLSMutex m_held_mutex;
+
+    //the parked players of the keys which are not live, signaled by add.
+    std::map<std::string, std::vector<SLSSubscriber *>> m_waiters;
+    CSLSMutex m_waiter_mutex;
+
+    void notify_waiters(const std::string &key);
 };
@@ -66,26 +66,62 @@ int CSLSMapPublisher::set_live_2_uplive(std::string strLive, std::string strUpli
 
 int CSLSMapPublisher::set_push_2_publisher(std::string app_streamname, CSLSRole *role)
 {
-    CSLSLock lock(&m_rwclock, true);
-    std::map<std::string, CSLSRole *>::iterator it;
-    it = m_map_push_2_publisher.find(app_streamname);
-    if (it != m_map_push_2_publisher.end())
+    CSLSRole *cur_role = NULL;
+    if (!m_map_push_2_publisher.insert(app_streamname, role, &cur_role))
     {
-        CSLSRole *cur_role = it->second;
         if (NULL != cur_role)
         {
-            spdlog::error("[{}] CSLSMapPublisher::set_push_2_publisher, failed, cur_role={}, exist, app_streamname={}, m_map_push_2_publisher.size()={:d}.",
-                          fmt::ptr(this), fmt::ptr(cur_role), app_streamname.c_str(), m_map_push_2_publisher.size());
+            spdlog::error("[{}] CSLSMapPublisher::set_push_2_publisher, failed, cur_role={}, exist, app_streamname={}.",
+                          fmt::ptr(this), fmt::ptr(cur_role), app_streamname.c_str());
             return SLS_ERROR;
         }
+        m_map_push_2_publisher.set(app_streamname, role);
+    }
+    m_map_publisher_2_push.set(role, app_streamname);
+
+    spdlog::info("[{}] CSLSMapPublisher::set_push_2_publisher, ok, {}={}, app_streamname={}.",
+                 fmt::ptr(this), role->get_role_name(), fmt::ptr(role), app_streamname.c_str());
+    return SLS_OK;
+}
+
+//a second publisher of the stream, it takes over when the publisher stalls or is gone.
+int CSLSMapPublisher::set_push_2_standby(std::string app_streamname, CSLSRole *role)
+{
+    CSLSRole *cur_role = NULL;
+    if (!m_map_push_2_standby.insert(app_streamname, role, &cur_role))
+    {
+        spdlog::error("[{}] CSLSMapPublisher::set_push_2_standby, failed, cur_role={}, exist, app_streamname={}.",
+                      fmt::ptr(this), fmt::ptr(cur_role), app_streamname.c_str());
+        return SLS_ERROR;
     }
+    m_map_publisher_2_push.set(role, app_streamname);
 
-    m_map_push_2_publisher[app_streamname] = role;
-    spdlog::info("[{}] CSLSMapPublisher::set_push_2_publisher, ok, {}={}, app_streamname={}, m_map_push_2_publisher.size()={:d}.",
-                 fmt::ptr(this), role->get_role_name(), fmt::ptr(role), app_streamname.c_str(), m_map_push_2_publisher.size());
+    spdlog::info("[{}] CSLSMapPublisher::set_push_2_standby, ok, {}={}, app_streamname={}.",
+                 fmt::ptr(this), role->get_role_name(), fmt::ptr(role), app_streamname.c_str());
     return SLS_OK;
 }
 
+//the publisher is gone, the standby becomes the publisher, return it or NULL.
+CSLSRole *CSLSMapPublisher::promote_standby(std::string app_streamname)
+{
+    CSLSLock lock(&m_mutex_standby);
+    CSLSRole *role = NULL;
+    if (!m_map_push_2_standby.erase(app_streamname, &role) || NULL == role)
+    {
+        return NULL;
+    }
+    if (!m_map_push_2_publisher.insert(app_streamname, role))
+    {
+        spdlog::error("[{}] CSLSMapPublisher::promote_standby, failed, publisher exists, app_streamname={}.",
+                      fmt::ptr(this), app_streamname.c_str());
+        m_map_push_2_standby.set(app_streamname, role);
+        return NULL;
+    }
+    spdlog::info("[{}] CSLSMapPublisher::promote_standby, ok, {}={}, app_streamname={}.",
+                 fmt::ptr(this), role->get_role_name(), fmt::ptr(role), app_streamname.c_str());
+    return role;
+}
+
 std::string CSLSMapPublisher::get_uplive(std::string key_app)
 {
     CSLSLock lock(&m_rwclock, false);
@@ -115,60 +151,63 @@ sls_conf_base_t *CSLSMapPublisher::get_ca(std::string key_app)
 
 CSLSRole *CSLSMapPublisher::get_publisher(std::string strAppStreamName)
 {
-    CSLSLock lock(&m_rwclock, false);
-
     CSLSRole *publisher = NULL;
-    std::map<std::string, CSLSRole *>::iterator item;
-    item = m_map_push_2_publisher.find(strAppStreamName);
-    if (item != m_map_push_2_publisher.end())
-    {
-        publisher = item->second;
-    }
+    m_map_push_2_publisher.find(strAppStreamName, publisher);
     return publisher;
 }
 
+CSLSRole *CSLSMapPublisher::get_standby(std::string strAppStreamName)
+{
+    CSLSRole *standby = NULL;
+    m_map_push_2_standby.find(strAppStreamName, standby);
+    return standby;
+}
+
 std::vector<std::string> CSLSMapPublisher::get_publisher_names() {
     std::vector<std::string> ret;
-    for (auto val : m_map_push_2_publisher) {
-        std::string streamName = val.first;
+    m_map_push_2_publisher.for_each([&ret](const std::string &streamName, CSLSRole *&pub) {
         ret.push_back(streamName);
-    }
+    });
     return ret;
 }
 
 std::map<std::string, CSLSRole *> CSLSMapPublisher::get_publishers()
 {
-    CSLSLock lock(&m_rwclock, false); // Read lock
     // Return a copy of the map to avoid issues with concurrent modification
     // if the caller iterates while another thread modifies the original map.
-    return m_map_push_2_publisher;
+    std::map<std::string, CSLSRole *> ret;
+    m_map_push_2_publisher.for_each([&ret](const std::string &streamName, CSLSRole *&pub) {
+        ret[streamName] = pub;
+    });
+    return ret;
 }
 
 int CSLSMapPublisher::remove(CSLSRole *role)
 {
-    int ret = SLS_ERROR;
-
-    CSLSLock lock(&m_rwclock, true);
-
-    for (auto const &[live_stream_name, pub] : m_map_push_2_publisher)
+    CSLSLock lock(&m_mutex_standby);
+    std::string live_stream_name;
+    if (!m_map_publisher_2_push.erase(role, &live_stream_name))
     {
-        if (role == pub)
-        {
-            spdlog::info("[{}] CSLSMapPublisher::remove, {}={}, live_key={}.",
-                         fmt::ptr(this), pub->get_role_name(), fmt::ptr(pub), live_stream_name.c_str());
-            m_map_push_2_publisher.erase(live_stream_name);
-            ret = SLS_OK;
-            break;
-        }
+        return SLS_ERROR;
     }
-    return ret;
+    if (!m_map_push_2_publisher.erase_if(live_stream_name, role) &&
+        !m_map_push_2_standby.erase_if(live_stream_name, role))
+    {
+        return SLS_ERROR;
+    }
+    spdlog::info("[{}] CSLSMapPublisher::remove, {}={}, live_key={}.",
+                 fmt::ptr(this), role->get_role_name(), fmt::ptr(role), live_stream_name.c_str());
+    return SLS_OK;
 }
 
 void CSLSMapPublisher::clear()
 {
-    CSLSLock lock(&m_rwclock, true);
     spdlog::debug("[{}] CSLSMapPublisher::clear", fmt::ptr(this));
     m_map_push_2_publisher.clear();
+    m_map_push_2_standby.clear();
+    m_map_publisher_2_push.clear();
+
+    CSLSLock lock(&m_rwclock, true);
     m_map_live_2_uplive.clear();
     m_map_uplive_2_conf.clear();
 }
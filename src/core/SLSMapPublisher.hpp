@@ -28,6 +28,7 @@
 
 #include "conf.hpp"
 #include "SLSLock.hpp"
+#include "SLSShardedMap.hpp"
 #include "SLSRole.hpp"
 
 class CSLSMapPublisher
@@ -39,6 +40,8 @@ public:
     int set_conf(std::string key, sls_conf_base_t *ca);
     int set_live_2_uplive(std::string strLive, std::string strUplive);
     int set_push_2_publisher(std::string app_streamname, CSLSRole *role);
+    int set_push_2_standby(std::string app_streamname, CSLSRole *role);
+    CSLSRole *promote_standby(std::string app_streamname);
     int remove(CSLSRole *role);
     void clear();
 
@@ -46,13 +49,17 @@ public:
     sls_conf_base_t *get_ca(std::string key_app);
 
     CSLSRole *get_publisher(std::string strAppStreamName);
+    CSLSRole *get_standby(std::string strAppStreamName);
     std::vector<std::string> get_publisher_names();
     std::map<std::string, CSLSRole *> get_publishers();
 
 private:
     std::map<std::string, std::string> m_map_live_2_uplive;       // 'hostname/live':'hostname/uplive'
     std::map<std::string, sls_conf_base_t *> m_map_uplive_2_conf; // 'hostname/uplive':sls_app_conf_t
-    std::map<std::string, CSLSRole *> m_map_push_2_publisher;    // 'hostname/uplive/steam_name':publisher'
+    CSLSShardedMap<std::string, CSLSRole *> m_map_push_2_publisher; // 'hostname/uplive/steam_name':publisher'
+    CSLSShardedMap<std::string, CSLSRole *> m_map_push_2_standby;   // 'hostname/uplive/steam_name':standby publisher'
+    CSLSShardedMap<CSLSRole *, std::string> m_map_publisher_2_push; // publisher or standby:'hostname/uplive/steam_name'
+    CSLSMutex m_mutex_standby; //a standby is promoted and removed one at a time
 
     CSLSRWLock m_rwclock;
 };
@@ -58,19 +58,12 @@ CSLSRelayManager *CSLSMapRelay::add_relay_manager(const char *app_uplive, const
     }
 
     std::string key_stream_name = std::string(app_uplive) + std::string("/") + std::string(stream_name);
-    CSLSLock lock(&m_rwclock, true);
     CSLSRelayManager *cur_manager = NULL;
-    std::map<std::string, CSLSRelayManager *>::iterator item;
-    item = m_map_relay_manager.find(key_stream_name);
-    if (item != m_map_relay_manager.end())
+    if (m_map_relay_manager.find(key_stream_name, cur_manager) && NULL != cur_manager)
     {
-        cur_manager = item->second;
-        if (NULL != cur_manager)
-        {
-            spdlog::info("[{}] CSLSMapRelay::add, cur_manager={}, exist, app_uplive={}, stream_name={}.",
-                         fmt::ptr(this), fmt::ptr(cur_manager), app_uplive, stream_name);
-            return cur_manager;
-        }
+        spdlog::info("[{}] CSLSMapRelay::add, cur_manager={}, exist, app_uplive={}, stream_name={}.",
+                     fmt::ptr(this), fmt::ptr(cur_manager), app_uplive, stream_name);
+        return cur_manager;
     }
 
     if (strcmp(sri->m_type, "pull") == 0)
@@ -86,7 +79,17 @@ CSLSRelayManager *CSLSMapRelay::add_relay_manager(const char *app_uplive, const
     cur_manager->set_relay_conf(sri);
     cur_manager->set_relay_info(app_uplive, stream_name);
 
-    m_map_relay_manager[key_stream_name] = cur_manager;
+    CSLSRelayManager *exist_manager = NULL;
+    if (!m_map_relay_manager.insert(key_stream_name, cur_manager, &exist_manager))
+    {
+        if (NULL != exist_manager)
+        {
+            //added by another thread meanwhile.
+            delete cur_manager;
+            return exist_manager;
+        }
+        m_map_relay_manager.set(key_stream_name, cur_manager);
+    }
     spdlog::info("[{}] CSLSMapRelay::add_relay_manager, ok, app_uplive={}, stream_name={}, cur_manager={}.",
                  fmt::ptr(this), app_uplive, stream_name, fmt::ptr(cur_manager));
     return cur_manager;
@@ -94,11 +97,12 @@ CSLSRelayManager *CSLSMapRelay::add_relay_manager(const char *app_uplive, const
 
 void CSLSMapRelay::clear()
 {
-    CSLSLock lock(&m_rwclock, true);
     spdlog::info("[{}] CSLSMapRelay::clear.", fmt::ptr(this));
 
+    std::map<std::string, CSLSRelayManager *> relay_managers;
+    m_map_relay_manager.clear(&relay_managers);
     std::map<std::string, CSLSRelayManager *>::iterator it;
-    for (it = m_map_relay_manager.begin(); it != m_map_relay_manager.end();)
+    for (it = relay_managers.begin(); it != relay_managers.end();)
     {
         CSLSRelayManager *relay_manager = it->second;
         if (NULL != relay_manager)
@@ -107,7 +111,8 @@ void CSLSMapRelay::clear()
         }
         it++;
     }
-    m_map_relay_manager.clear();
+
+    CSLSLock lock(&m_rwclock, true);
 
     std::map<std::string, SLS_RELAY_INFO *>::iterator it_sri;
     for (it_sri = m_map_relay_info.begin(); it_sri != m_map_relay_info.end();)
@@ -44,6 +44,7 @@ CSLSPublisher::CSLSPublisher()
 {
     m_is_write = 0;
     m_map_publisher = NULL;
+    m_reconnect_grace = 0;
 
     sprintf(m_role_name, "publisher");
 }
@@ -62,6 +63,8 @@ int CSLSPublisher::init()
         //m_exit_delay = ((sls_conf_app_t *)m_conf)->publisher_exit_delay;
         strlcpy(m_record_hls, app_conf->record_hls, sizeof(m_record_hls));
         m_record_hls_segment_duration = app_conf->record_hls_segment_duration;
+        m_reconnect_grace = app_conf->publisher_reconnect_grace * 1000;
+        m_stall_timeout = app_conf->publisher_stall_timeout;
     }
 
     return ret;
@@ -70,19 +73,33 @@ int CSLSPublisher::init()
 int CSLSPublisher::uninit()
 {
     int ret = SLS_OK;
+    bool standby = true;
+    CSLSRole *next_publisher = NULL;
 
-    if (m_map_data)
+    if (m_map_publisher)
     {
-        ret = m_map_data->remove(m_map_data_key);
-        spdlog::info("[{}] CSLSPublisher::uninit, removed publisher from m_map_data, ret={:d}.",
-                     fmt::ptr(this), ret);
+        standby = m_map_publisher->get_publisher(m_map_data_key) != this;
+        ret = m_map_publisher->remove(this);
+        spdlog::info("[{}] CSLSPublisher::uninit, removed publisher from m_map_publisher, standby={:d}, ret={:d}.",
+                     fmt::ptr(this), standby, ret);
+        if (!standby)
+        {
+            next_publisher = m_map_publisher->promote_standby(m_map_data_key);
+        }
     }
 
-    if (m_map_publisher)
+    if (m_stream)
     {
-        ret = m_map_publisher->remove(this);
-        spdlog::info("[{}] CSLSPublisher::uninit, removed publisher from m_map_publisher, ret={:d}.",
-                     fmt::ptr(this), ret);
+        m_stream->release_ingest(this);
+    }
+
+    //the stream goes on with the standby publisher if there is one.
+    if (m_map_data && !standby && NULL == next_publisher)
+    {
+        //players stay attached to the held stream, a returning publisher resumes it.
+        ret = m_map_data->hold(m_map_data_key, m_reconnect_grace);
+        spdlog::info("[{}] CSLSPublisher::uninit, released publisher from m_map_data, grace={:d}ms, ret={:d}.",
+                     fmt::ptr(this), m_reconnect_grace, ret);
     }
     return CSLSRole::uninit();
 }
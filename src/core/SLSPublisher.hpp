@@ -40,6 +40,16 @@ int publisher_exit_delay;
 char record_hls[SHORT_STR_MAX_LEN];
 int record_hls_segment_duration;
 sls_ip_acl_t ip_actions;
+char gop_cache[SHORT_STR_MAX_LEN];
+int ring_min_size;
+int ring_max_size;
+char ring_message_mode[SHORT_STR_MAX_LEN];
+int publisher_reconnect_grace;
+int player_wait_timeout;
+int publisher_stall_timeout;
+int timeshift_duration;
+int timeshift_memory;
+char timeshift_path[URL_MAX_LEN];
 SLS_CONF_DYNAMIC_DECLARE_END
 
 /**
@@ -53,6 +63,16 @@ SLS_SET_CONF(app, string, app_player, "live", 1, STR_MAX_LEN - 1),
     SLS_SET_CONF(app, int, record_hls_segment_duration, "record_hls_segment_duration", 1, 3600),
     SLS_SET_CONF2(app, ipset, ip_actions, allow, "allow address(es) to play/publish a stream", 1, 256),
     SLS_SET_CONF2(app, ipset, ip_actions, deny, "deny address(es) from playing/publishing a stream", 1, 256),
+    SLS_SET_CONF(app, string, gop_cache, "players start from the last keyframe, on or off", 1, SHORT_STR_MAX_LEN - 1),
+    SLS_SET_CONF(app, int, ring_min_size, "min stream ring size, unit kbyte.", 64, 1024 * 1024),
+    SLS_SET_CONF(app, int, ring_max_size, "max stream ring size, unit kbyte.", 64, 1024 * 1024),
+    SLS_SET_CONF(app, int, publisher_reconnect_grace, "keep the stream and players for a returning publisher, unit second.", 0, 3600),
+    SLS_SET_CONF(app, int, publisher_stall_timeout, "accept a standby publisher which takes over after the publisher stalls, unit ms.", 0, 60000),
+    SLS_SET_CONF(app, int, player_wait_timeout, "players wait for a stream which is not live yet, unit second.", 0, 86400),
+    SLS_SET_CONF(app, string, ring_message_mode, "players get the messages of the publisher as they are, on or off", 1, SHORT_STR_MAX_LEN - 1),
+    SLS_SET_CONF(app, int, timeshift_duration, "keep the stream for players joining with an offset, unit second.", 0, 86400),
+    SLS_SET_CONF(app, int, timeshift_memory, "the recent part of the time shift kept in memory, unit second.", 0, 86400),
+    SLS_SET_CONF(app, string, timeshift_path, "time shift segments out of the memory are spilled to this path", 1, URL_MAX_LEN - 1),
     SLS_CONF_CMD_DYNAMIC_DECLARE_END
 
     /**
@@ -73,4 +93,5 @@ public:
 
 private:
     CSLSMapPublisher *m_map_publisher;
+    int m_reconnect_grace; //ms
 };
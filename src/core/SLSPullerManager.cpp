@@ -30,6 +30,8 @@
 #include "SLSPullerManager.hpp"
 #include "SLSLog.hpp"
 #include "SLSPuller.hpp"
+#include "SLSPublisher.hpp"
+#include "util.hpp"
 
 /**
  * CSLSPullerManager class implementation
@@ -198,7 +200,19 @@ int CSLSPullerManager::set_relay_param(CSLSRelay *relay)
 		return SLS_ERROR;
 	}
 
-	if (SLS_OK != m_map_data->add(key_stream_name))
+	SLSRingConf ring_conf = {0};
+	SLSTimeShiftConf timeshift_conf = {0};
+	sls_conf_app_t *ca = (sls_conf_app_t *)m_map_publisher->get_ca(m_app_uplive);
+	if (ca)
+	{
+		ring_conf.min_size = ca->ring_min_size * 1024;
+		ring_conf.max_size = ca->ring_max_size * 1024;
+		ring_conf.message_mode = strcmp(ca->ring_message_mode, "on") == 0;
+		timeshift_conf.duration = ca->timeshift_duration * 1000;
+		timeshift_conf.memory = ca->timeshift_memory * 1000;
+		strlcpy(timeshift_conf.path, ca->timeshift_path, sizeof(timeshift_conf.path));
+	}
+	if (SLS_OK != m_map_data->add(key_stream_name, &ring_conf, &timeshift_conf))
 	{
 		spdlog::warn("[{}] CSLSRelayManager::set_relay_param, m_map_data->add failed, stream={}, remove from relay={}, m_map_publisher.",
 					 fmt::ptr(this), key_stream_name, fmt::ptr(relay));
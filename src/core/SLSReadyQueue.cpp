@@ -0,0 +1,120 @@
+
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Edward.Wu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include "spdlog/spdlog.h"
+
+#include "SLSReadyQueue.hpp"
+#include "SLSLog.hpp"
+#include "common.hpp"
+
+/**
+ * CSLSReadyQueue class implementation
+ */
+
+CSLSReadyQueue::CSLSReadyQueue()
+{
+    m_event_fd = -1;
+}
+
+CSLSReadyQueue::~CSLSReadyQueue()
+{
+    close();
+}
+
+int CSLSReadyQueue::open()
+{
+    if (m_event_fd >= 0)
+    {
+        return SLS_OK;
+    }
+    m_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_event_fd < 0)
+    {
+        spdlog::error("[{}] CSLSReadyQueue::open, eventfd failed, errno={:d}.", fmt::ptr(this), errno);
+        return SLS_ERROR;
+    }
+    return SLS_OK;
+}
+
+void CSLSReadyQueue::close()
+{
+    if (m_event_fd >= 0)
+    {
+        ::close(m_event_fd);
+        m_event_fd = -1;
+    }
+}
+
+int CSLSReadyQueue::get_fd()
+{
+    return m_event_fd;
+}
+
+//called by the publishers, the worker is only woken by the first fd of a batch.
+void CSLSReadyQueue::push(int fd)
+{
+    bool wake;
+    {
+        CSLSLock lock(&m_mutex);
+        wake = m_fds.empty();
+        m_fds.push_back(fd);
+    }
+    if (wake)
+    {
+        this->wake();
+    }
+}
+
+//interrupt the wait of the worker without any ready role, e.g. for new roles.
+void CSLSReadyQueue::wake()
+{
+    if (m_event_fd >= 0)
+    {
+        uint64_t value = 1;
+        if (write(m_event_fd, &value, sizeof(value)) < 0 && errno != EAGAIN)
+        {
+            spdlog::warn("[{}] CSLSReadyQueue::wake, write eventfd failed, errno={:d}.", fmt::ptr(this), errno);
+        }
+    }
+}
+
+//only called by the worker, take all the ready fds and clear the event.
+int CSLSReadyQueue::pop_all(std::vector<int> &fds)
+{
+    fds.clear();
+    if (m_event_fd >= 0)
+    {
+        uint64_t value = 0;
+        while (read(m_event_fd, &value, sizeof(value)) > 0)
+        {
+        }
+    }
+    CSLSLock lock(&m_mutex);
+    fds.swap(m_fds);
+    return fds.size();
+}
@@ -0,0 +1,55 @@
+
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Edward.Wu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "SLSLock.hpp"
+
+/**
+ * CSLSReadyQueue
+ * the roles of a worker whose stream has new data, pushed by the publishers
+ * of any worker. the worker polls the event fd with its srt sockets and is
+ * woken once per batch, the roles are identified by their sockets.
+ */
+class CSLSReadyQueue
+{
+public:
+    CSLSReadyQueue();
+    ~CSLSReadyQueue();
+
+    int open();
+    void close();
+    int get_fd();
+
+    void push(int fd);
+    void wake();
+    int pop_all(std::vector<int> &fds);
+
+private:
+    CSLSMutex m_mutex;
+    std::vector<int> m_fds;
+    int m_event_fd;
+};
@@ -29,92 +29,305 @@
 #include "SLSLog.hpp"
 
 const int DEFAULT_MAX_DATA_SIZE = 1024 * 1316; //about 5mbps*2sec
+const int DEFAULT_GOP_DURATION = 1000;         //ms, used before any keyframe is found
+
+static std::atomic<int64_t> g_ring_id(0);
+static std::atomic<int> g_reader_slot(0);
+static thread_local int t_reader_slot = -1;
 
 CSLSRecycleArray::CSLSRecycleArray()
 {
-    m_nDataSize = DEFAULT_MAX_DATA_SIZE;
-    m_nWritePos = 0;
+    m_nChunkCount = DEFAULT_MAX_DATA_SIZE / SLS_CHUNK_SIZE;
+    m_nMinCount = m_nChunkCount;
+    m_nActiveCount = m_nChunkCount;
+    m_nTrimSeq = 0;
+    m_nReserveLen = 0;
+    m_latency = 0;
+    m_nWriteSeq = 0;
     m_nDataCount = 0;
+    m_ring_id = ++g_ring_id;
+    m_lock_free = false;
+    m_message_mode = false;
+    m_nKeyFrameCount = 0;
 
-    m_last_read_time = sls_gettime_ms();
+    int64_t cur_time = sls_gettime_ms();
+    for (int i = 0; i < SLS_READER_SLOT_COUNT; i++)
+    {
+        m_reader_slots[i].last_read_time = cur_time;
+    }
 
-    m_arrayData = new char[m_nDataSize];
+    m_arrayChunk = new std::atomic<SLSChunk *>[m_nChunkCount];
+    for (int i = 0; i < m_nChunkCount; i++)
+    {
+        m_arrayChunk[i] = NULL;
+    }
+    prepare_chunk(m_nWriteSeq);
 }
 
 CSLSRecycleArray::~CSLSRecycleArray()
 {
     CSLSLock lock(&m_rwclock, true);
-    if (m_arrayData != NULL)
-    {
-        delete[] m_arrayData;
-        m_arrayData = NULL;
-    }
+    free_chunks();
 }
 
-int CSLSRecycleArray::count()
+int64_t CSLSRecycleArray::count()
 {
-    CSLSLock lock(&m_rwclock, false);
-    return m_nDataCount;
+    return m_nDataCount.load(std::memory_order_relaxed);
 }
 
 //please call this function before get and put,
 //if not, the read data will be make confusion.
-void CSLSRecycleArray::setSize(int n)
+void CSLSRecycleArray::set_conf(const SLSRingConf *conf)
+{
+    int min_size = DEFAULT_MAX_DATA_SIZE;
+    int max_size = DEFAULT_MAX_DATA_SIZE;
+    if (conf)
+    {
+        if (conf->min_size > 0)
+            min_size = conf->min_size;
+        else if (conf->max_size > 0 && conf->max_size < min_size)
+            min_size = conf->max_size;
+        if (conf->max_size > 0)
+            max_size = conf->max_size;
+        if (max_size < min_size)
+            max_size = min_size;
+        m_latency = conf->latency;
+        m_message_mode = conf->message_mode;
+    }
+
+    CSLSLock lock(&m_rwclock, true);
+    free_chunks();
+    m_nChunkCount = max_size / SLS_CHUNK_SIZE;
+    if (m_nChunkCount < 2)
+        m_nChunkCount = 2;
+    m_nMinCount = min_size / SLS_CHUNK_SIZE;
+    if (m_nMinCount < 2)
+        m_nMinCount = 2;
+    int active = DEFAULT_MAX_DATA_SIZE / SLS_CHUNK_SIZE;
+    if (active < m_nMinCount)
+        active = m_nMinCount;
+    if (active > m_nChunkCount)
+        active = m_nChunkCount;
+    m_nActiveCount = active;
+    m_nTrimSeq = 0;
+    m_nReserveLen = 0;
+    m_nWriteSeq = 0;
+    m_nKeyFrameCount = 0;
+    m_arrayChunk = new std::atomic<SLSChunk *>[m_nChunkCount];
+    for (int i = 0; i < m_nChunkCount; i++)
+    {
+        m_arrayChunk[i] = NULL;
+    }
+    prepare_chunk(m_nWriteSeq);
+}
+
+//please call this function before get and put.
+void CSLSRecycleArray::set_lock_free(bool lock_free)
+{
+    m_lock_free = lock_free;
+}
+
+bool CSLSRecycleArray::is_message_mode()
+{
+    return m_message_mode;
+}
+
+SLSChunk *CSLSRecycleArray::alloc_chunk(int capacity)
+{
+    return CSLSRingArena::get_instance()->alloc_chunk(capacity);
+}
+
+void CSLSRecycleArray::add_ref_chunk(SLSChunk *chunk)
+{
+    chunk->ref.fetch_add(1, std::memory_order_relaxed);
+}
+
+//only succeeds while the chunk is still referenced by someone.
+bool CSLSRecycleArray::try_add_ref_chunk(SLSChunk *chunk)
+{
+    int ref = chunk->ref.load(std::memory_order_relaxed);
+    while (ref > 0)
+    {
+        if (chunk->ref.compare_exchange_weak(ref, ref + 1))
+            return true;
+    }
+    return false;
+}
+
+void CSLSRecycleArray::release_chunk(SLSChunk *chunk)
+{
+    if (chunk->ref.fetch_sub(1, std::memory_order_acq_rel) != 1)
+        return;
+    CSLSRingArena::get_instance()->free_chunk(chunk);
+}
+
+void CSLSRecycleArray::release_views(SLSChunkView *views, int view_count)
+{
+    for (int i = 0; i < view_count; i++)
+    {
+        if (views[i].chunk)
+        {
+            release_chunk(views[i].chunk);
+            views[i].chunk = NULL;
+        }
+    }
+}
+
+//only called by the producer.
+SLSChunk *CSLSRecycleArray::prepare_chunk(int64_t seq)
+{
+    trim_chunks(seq);
+    SLSChunk *chunk = alloc_chunk(SLS_CHUNK_SIZE);
+    chunk->ring_id.store(m_ring_id, std::memory_order_relaxed);
+    chunk->byte_seq.store(m_nDataCount.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    chunk->seq.store(seq, std::memory_order_release);
+    m_arrayChunk[seq % m_nChunkCount].store(chunk, std::memory_order_release);
+    return chunk;
+}
+
+//only called by the producer, drop the chunks which are out of the active size,
+//readers still sending from them keep their own references.
+void CSLSRecycleArray::trim_chunks(int64_t seq)
+{
+    int active = m_nActiveCount.load(std::memory_order_relaxed);
+    int64_t trim_seq = m_nTrimSeq.load(std::memory_order_relaxed);
+    while (seq - trim_seq >= active)
+    {
+        int slot = trim_seq % m_nChunkCount;
+        SLSChunk *chunk = m_arrayChunk[slot].load(std::memory_order_relaxed);
+        if (chunk != NULL)
+        {
+            //invalidate the old data first, readers referencing it from now on will fail.
+            chunk->seq.store(-1);
+            m_arrayChunk[slot].store(NULL, std::memory_order_release);
+            release_chunk(chunk);
+        }
+        trim_seq++;
+    }
+    m_nTrimSeq.store(trim_seq, std::memory_order_release);
+}
+
+//return a referenced chunk of seq, or NULL if it has been overwritten.
+SLSChunk *CSLSRecycleArray::acquire_chunk(int64_t seq)
 {
-    CSLSLock lock(&m_rwclock, false);
-    delete[] m_arrayData;
-    m_nDataSize = n;
-    m_nWritePos = 0;
-    m_arrayData = new char[m_nDataSize];
+    SLSChunk *chunk = m_arrayChunk[seq % m_nChunkCount].load(std::memory_order_acquire);
+    if (chunk == NULL || chunk->seq.load(std::memory_order_acquire) != seq)
+        return NULL;
+    if (!try_add_ref_chunk(chunk))
+        return NULL;
+    //check again, the producer may have recycled it before the reference.
+    if (chunk->seq.load() != seq || chunk->ring_id.load(std::memory_order_relaxed) != m_ring_id)
+    {
+        release_chunk(chunk);
+        return NULL;
+    }
+    return chunk;
 }
 
-int CSLSRecycleArray::put(char *data, int len)
+void CSLSRecycleArray::free_chunks()
+{
+    if (m_arrayChunk == NULL)
+        return;
+    for (int i = 0; i < m_nChunkCount; i++)
+    {
+        SLSChunk *chunk = m_arrayChunk[i].load();
+        if (chunk != NULL)
+        {
+            release_chunk(chunk);
+        }
+    }
+    delete[] m_arrayChunk;
+    m_arrayChunk = NULL;
+}
+
+int CSLSRecycleArray::put(char *data, int len, int keyframe_pos)
 {
     if (!data || len <= 0)
     {
         spdlog::error("[{}] CSLSRecycleArray::put, failed, data={:p}, len={:d}.",
-                      fmt::ptr(this), data, len);
+                      fmt::ptr(this), fmt::ptr(data), len);
         return SLS_ERROR;
     }
 
-    if (len > m_nDataSize)
+    char *buf = reserve(len);
+    if (NULL == buf)
     {
-        spdlog::error("[{}] CSLSRecycleArray::put, failed, len={:d} is bigger than m_nDataSize={:d}.",
-                      fmt::ptr(this), data, len, m_nDataSize);
         return SLS_ERROR;
     }
+    memcpy(buf, data, len);
+    return commit(len, keyframe_pos);
+}
 
+//only called by the producer, return at least len bytes of contiguous space in the open chunk,
+//the chunk is sealed first if the space doesn't fit, so a reservation never wraps.
+//the space is invisible to readers until it is committed, avail returns its whole size.
+char *CSLSRecycleArray::reserve(int len, int *avail)
+{
+    if (len <= 0 || len > SLS_CHUNK_SIZE)
     {
-        CSLSLock lock(&m_rwclock, true);
-        if (m_nDataSize - m_nWritePos >= len)
-        {
-            //copy directly
-            memcpy(m_arrayData + m_nWritePos, data, len);
-            m_nWritePos += len;
-        }
-        else
+        spdlog::error("[{}] CSLSRecycleArray::reserve, failed, len={:d}, SLS_CHUNK_SIZE={:d}.",
+                      fmt::ptr(this), len, SLS_CHUNK_SIZE);
+        return NULL;
+    }
+
+    CSLSLock lock(m_lock_free ? NULL : &m_rwclock, true);
+    int64_t write_seq = m_nWriteSeq.load(std::memory_order_relaxed);
+    SLSChunk *chunk = m_arrayChunk[write_seq % m_nChunkCount].load(std::memory_order_relaxed);
+    int chunk_len = chunk->len.load(std::memory_order_relaxed);
+    if (chunk->capacity - chunk_len < len)
+    {
+        //the current chunk is sealed, a message never spans two chunks.
+        write_seq++;
+        chunk = prepare_chunk(write_seq);
+        chunk_len = 0;
+        m_nWriteSeq.store(write_seq, std::memory_order_release);
+    }
+    m_nReserveLen = chunk->capacity - chunk_len;
+    if (avail)
+        *avail = m_nReserveLen;
+    return chunk->data + chunk_len;
+}
+
+//only called by the producer, publish len bytes of the last reservation,
+//cur_time_ms is the time of a keyframe in it, 0: now.
+int CSLSRecycleArray::commit(int len, int keyframe_pos, int64_t cur_time_ms)
+{
+    if (len < 0 || len > m_nReserveLen)
+    {
+        spdlog::error("[{}] CSLSRecycleArray::commit, failed, len={:d}, m_nReserveLen={:d}.",
+                      fmt::ptr(this), len, m_nReserveLen);
+        m_nReserveLen = 0;
+        return SLS_ERROR;
+    }
+    m_nReserveLen = 0;
+    if (len == 0)
+        return 0;
+
+    {
+        CSLSLock lock(m_lock_free ? NULL : &m_rwclock, true);
+        int64_t write_seq = m_nWriteSeq.load(std::memory_order_relaxed);
+        SLSChunk *chunk = m_arrayChunk[write_seq % m_nChunkCount].load(std::memory_order_relaxed);
+        int chunk_len = chunk->len.load(std::memory_order_relaxed);
+        chunk->len.store(chunk_len + len, std::memory_order_release);
+        m_nDataCount.fetch_add(len, std::memory_order_relaxed);
+        if (keyframe_pos >= 0 && keyframe_pos < len)
         {
-            int first_len = m_nDataSize - m_nWritePos;
-            memcpy(m_arrayData + m_nWritePos, data, first_len);
-            memcpy(m_arrayData, data + first_len, len - first_len);
-            m_nWritePos = (len - first_len);
+            add_keyframe(write_seq, chunk_len + keyframe_pos, cur_time_ms > 0 ? cur_time_ms : sls_gettime_ms());
         }
-
-        if (m_nWritePos == m_nDataSize)
-            m_nWritePos = 0;
     }
-    //no consider int wrapround;
-    m_nDataCount += len;
-    spdlog::trace("[{}] CSLSRecycleArray::put, len={:d}, m_nWritePos={:d}, m_nDataCount={:d}, m_nDataSize={:d}.",
-                  fmt::ptr(this), len, m_nWritePos, m_nDataCount, m_nDataSize);
+    spdlog::trace("[{}] CSLSRecycleArray::commit, len={:d}, m_nWriteSeq={:d}, m_nDataCount={:d}, m_nActiveCount={:d}.",
+                  fmt::ptr(this), len, m_nWriteSeq.load(), m_nDataCount.load(), m_nActiveCount.load());
     return len;
 }
 
-int CSLSRecycleArray::get(char *data, int size, SLSRecycleArrayID *read_id, int aligned)
+int CSLSRecycleArray::get(SLSChunkView *views, int &view_count, SLSRecycleArrayID *read_id, int aligned)
 {
-    if (NULL == m_arrayData)
+    int max_view_count = view_count;
+    view_count = 0;
+
+    if (NULL == m_arrayChunk)
     {
-        spdlog::error("[{}] CSLSRecycleArray::get, failed, m_arrayData is NULL.", fmt::ptr(this));
+        spdlog::error("[{}] CSLSRecycleArray::get, failed, m_arrayChunk is NULL.", fmt::ptr(this));
         return SLS_ERROR;
     }
 
@@ -124,89 +337,218 @@ int CSLSRecycleArray::get(char *data, int size, SLSRecycleArrayID *read_id, int
         return SLS_ERROR;
     }
 
+    CSLSLock lock(m_lock_free ? NULL : &m_rwclock, false);
+    int64_t write_seq = m_nWriteSeq.load(std::memory_order_acquire);
     if (read_id->bFirst)
     {
-        read_id->nReadPos = m_nWritePos;
-        read_id->nDataCount = m_nDataCount;
+        write_seq = sync_read_id(read_id, read_id->bKeyFrameStart);
         read_id->bFirst = false;
-        spdlog::trace("[{}] CSLSRecycleArray::get, the first time.", fmt::ptr(this));
-        return SLS_OK;
+        spdlog::trace("[{}] CSLSRecycleArray::get, the first time, nChunkSeq={:d}, write_seq={:d}.",
+                      fmt::ptr(this), read_id->nChunkSeq, write_seq);
     }
-
-    CSLSLock lock(&m_rwclock, false);
-    if (read_id->nReadPos == m_nWritePos && m_nDataCount == read_id->nDataCount)
+    else if (write_seq - read_id->nChunkSeq >= m_nActiveCount.load(std::memory_order_relaxed))
     {
-        spdlog::trace("[{}] CSLSRecycleArray::get, no new data.", fmt::ptr(this));
-        return SLS_OK;
+        read_id->nOverrun++;
+        spdlog::warn("[{}] CSLSRecycleArray::get, reader is overrun, nChunkSeq={:d}, write_seq={:d}, nOverrun={:d}, skip to the last keyframe.",
+                     fmt::ptr(this), read_id->nChunkSeq, write_seq, read_id->nOverrun);
+        write_seq = sync_read_id(read_id, true);
     }
-    spdlog::trace("[{}] CSLSRecycleArray::get, read_id->nReadPos={:d}, m_nWritePos={:d}, m_nDataCount={:d}, m_nDataSize={:d}.",
-                  fmt::ptr(this), read_id->nReadPos, m_nWritePos, m_nDataCount, m_nDataSize);
-
-    //update the last read time
-    m_last_read_time = sls_gettime_ms();
 
     int ready_data_len = 0;
-    int copy_data_len = 0;
-    if (read_id->nReadPos < m_nWritePos)
+    while (view_count < max_view_count && read_id->nChunkSeq <= write_seq)
     {
-        //read pos is behind in the write pos
-        ready_data_len = m_nWritePos - read_id->nReadPos;
-        copy_data_len = ready_data_len <= size ? ready_data_len : size;
-        if (aligned > 0)
+        SLSChunk *chunk = acquire_chunk(read_id->nChunkSeq);
+        if (NULL == chunk)
         {
-            copy_data_len = copy_data_len / aligned * aligned;
+            //overwritten by the producer while we were reading.
+            read_id->nOverrun++;
+            spdlog::warn("[{}] CSLSRecycleArray::get, chunk is overwritten, nChunkSeq={:d}, nOverrun={:d}, skip to the last keyframe.",
+                         fmt::ptr(this), read_id->nChunkSeq, read_id->nOverrun);
+            write_seq = sync_read_id(read_id, true);
+            continue;
         }
-        //sls_log(SLS_LOG_TRACE, "[%p]CSLSRecycleArray::get, read pos is behind in the write pos, copy_data_len=%d, ready_data_len=%d, size=%d.",
-        //		this, copy_data_len, ready_data_len, size);
-        if (copy_data_len > 0)
+        bool sealed = read_id->nChunkSeq < write_seq;
+        int len = chunk->len.load(std::memory_order_acquire) - read_id->nChunkPos;
+        if (!sealed && aligned > 0 && !m_message_mode)
         {
-            memcpy(data, m_arrayData + read_id->nReadPos, copy_data_len);
-            read_id->nReadPos += copy_data_len;
+            //the tail of a sealed chunk is sent as it is,
+            //in message mode only whole messages are committed, nothing to align.
+            len = len / aligned * aligned;
         }
-    }
-    else
-    {
-        ready_data_len = m_nDataSize - read_id->nReadPos + m_nWritePos;
-        copy_data_len = ready_data_len <= size ? ready_data_len : size;
-        if (aligned > 0)
+        if (len > 0)
         {
-            copy_data_len = copy_data_len / aligned * aligned;
+            views[view_count].chunk = chunk;
+            views[view_count].offset = read_id->nChunkPos;
+            views[view_count].len = len;
+            view_count++;
+            read_id->nChunkPos += len;
+            read_id->nByteSeq = chunk->byte_seq.load(std::memory_order_relaxed) + read_id->nChunkPos;
+            ready_data_len += len;
         }
-        //sls_log(SLS_LOG_TRACE, "[%p]CSLSRecycleArray::get, read pos is before of the write pos, copy_data_len=%d, ready_data_len=%d, size=%d.",
-        //		this, copy_data_len, ready_data_len, size);
-        if (copy_data_len > 0)
+        else
+        {
+            release_chunk(chunk);
+        }
+        if (!sealed)
+            break;
+        read_id->nChunkSeq++;
+        read_id->nChunkPos = 0;
+    }
+
+    if (0 == ready_data_len)
+    {
+        spdlog::trace("[{}] CSLSRecycleArray::get, no new data.", fmt::ptr(this));
+        return SLS_OK;
+    }
+
+    //update the last read time
+    update_last_read_time();
+
+    spdlog::trace("[{}] CSLSRecycleArray::get, ready_data_len={:d}, view_count={:d}.",
+                  fmt::ptr(this), ready_data_len, view_count);
+    return ready_data_len;
+}
+
+//move the reader to the last keyframe or the write pos, return the write seq.
+int64_t CSLSRecycleArray::sync_read_id(SLSRecycleArrayID *read_id, bool keyframe)
+{
+    SLSChunk *chunk = NULL;
+    int64_t write_seq = m_nWriteSeq.load(std::memory_order_acquire);
+    int64_t chunk_seq = 0;
+    int chunk_pos = 0;
+    if (keyframe && get_last_keyframe(write_seq, chunk_seq, chunk_pos))
+    {
+        chunk = acquire_chunk(chunk_seq);
+        if (NULL != chunk)
         {
-            if (m_nDataSize - read_id->nReadPos >= copy_data_len)
-            {
-                //no wrap round
-                memcpy(data, m_arrayData + read_id->nReadPos, copy_data_len);
-                read_id->nReadPos += copy_data_len;
-            }
-            else
-            {
-                memcpy(data, m_arrayData + read_id->nReadPos, m_nDataSize - read_id->nReadPos);
-                //wrap around
-                memcpy(data + (m_nDataSize - read_id->nReadPos), m_arrayData, copy_data_len - (m_nDataSize - read_id->nReadPos));
-                read_id->nReadPos = copy_data_len - (m_nDataSize - read_id->nReadPos);
-            }
+            read_id->nChunkSeq = chunk_seq;
+            read_id->nChunkPos = chunk_pos;
+            read_id->nByteSeq = chunk->byte_seq.load(std::memory_order_relaxed) + chunk_pos;
+            release_chunk(chunk);
+            return write_seq;
         }
     }
-    if (read_id->nReadPos == m_nDataSize)
-        read_id->nReadPos = 0;
 
-    if (read_id->nReadPos > m_nDataSize)
+    while (NULL == (chunk = acquire_chunk(write_seq)))
+    {
+        write_seq = m_nWriteSeq.load(std::memory_order_acquire);
+    }
+    read_id->nChunkSeq = write_seq;
+    read_id->nChunkPos = chunk->len.load(std::memory_order_acquire);
+    read_id->nByteSeq = chunk->byte_seq.load(std::memory_order_relaxed) + read_id->nChunkPos;
+    release_chunk(chunk);
+    return write_seq;
+}
+
+//only called by the producer after the keyframe data is written.
+void CSLSRecycleArray::add_keyframe(int64_t chunk_seq, int chunk_pos, int64_t cur_time_ms)
+{
+    int64_t n = m_nKeyFrameCount.load(std::memory_order_relaxed);
+    SLSKeyFrame &kf = m_keyframes[n % SLS_KEYFRAME_COUNT];
+    kf.chunk_seq.store(chunk_seq, std::memory_order_relaxed);
+    kf.chunk_pos.store(chunk_pos, std::memory_order_relaxed);
+    kf.time_ms.store(cur_time_ms, std::memory_order_relaxed);
+    m_nKeyFrameCount.store(n + 1, std::memory_order_release);
+}
+
+//the last keyframe which is still kept in the ring.
+bool CSLSRecycleArray::get_last_keyframe(int64_t write_seq, int64_t &chunk_seq, int &chunk_pos)
+{
+    int64_t n = m_nKeyFrameCount.load(std::memory_order_acquire);
+    if (n == 0)
+        return false;
+    SLSKeyFrame &kf = m_keyframes[(n - 1) % SLS_KEYFRAME_COUNT];
+    chunk_seq = kf.chunk_seq.load(std::memory_order_relaxed);
+    chunk_pos = kf.chunk_pos.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (m_nKeyFrameCount.load(std::memory_order_relaxed) - n >= SLS_KEYFRAME_COUNT - 1)
+        return false;
+    //the oldest chunk may be recycled at any time, don't start there.
+    return write_seq - chunk_seq < m_nActiveCount.load(std::memory_order_relaxed) - 1;
+}
+
+//the average keyframe interval of the recent keyframes, 0 if unknown.
+int64_t CSLSRecycleArray::get_gop_duration()
+{
+    int64_t n = m_nKeyFrameCount.load(std::memory_order_acquire);
+    int64_t samples = n < SLS_GOP_SAMPLE_COUNT ? n : SLS_GOP_SAMPLE_COUNT;
+    if (samples < 2)
+        return 0;
+    int64_t last = m_keyframes[(n - 1) % SLS_KEYFRAME_COUNT].time_ms.load(std::memory_order_relaxed);
+    int64_t first = m_keyframes[(n - samples) % SLS_KEYFRAME_COUNT].time_ms.load(std::memory_order_relaxed);
+    return (last - first) / (samples - 1);
+}
+
+//only called by the producer, keep two gops plus the latency of data.
+//grow at once, but shrink only when the target is much smaller,
+//so that the ring is not resized back and forth by bitrate jitter.
+void CSLSRecycleArray::adapt_size(int kbitrate)
+{
+    if (kbitrate <= 0 || m_nMinCount >= m_nChunkCount)
+        return;
+
+    int64_t duration = get_gop_duration();
+    if (duration <= 0)
+        duration = DEFAULT_GOP_DURATION;
+    duration = duration * 2 + m_latency;
+    //kbit/s * ms / 8 = bytes, one more chunk for the open one.
+    int64_t count = (int64_t)kbitrate * duration / 8 / SLS_CHUNK_SIZE + 1;
+    if (count < m_nMinCount)
+        count = m_nMinCount;
+    if (count > m_nChunkCount)
+        count = m_nChunkCount;
+
+    int active = m_nActiveCount.load(std::memory_order_relaxed);
+    if (count == active || (count < active && count > active * 3 / 4))
+        return;
+    m_nActiveCount.store((int)count, std::memory_order_relaxed);
+    spdlog::info("[{}] CSLSRecycleArray::adapt_size, kbitrate={:d}, duration={:d}ms, size {:d} -> {:d}.",
+                 fmt::ptr(this), kbitrate, duration, active * SLS_CHUNK_SIZE, count * SLS_CHUNK_SIZE);
+}
+
+int CSLSRecycleArray::get_size()
+{
+    return m_nActiveCount.load(std::memory_order_relaxed) * SLS_CHUNK_SIZE;
+}
+
+//bytes kept in the ring, the unused tails of sealed chunks are counted too.
+int64_t CSLSRecycleArray::get_used()
+{
+    int64_t write_seq = m_nWriteSeq.load(std::memory_order_acquire);
+    int64_t trim_seq = m_nTrimSeq.load(std::memory_order_acquire);
+    int64_t used = write_seq > trim_seq ? (write_seq - trim_seq) * SLS_CHUNK_SIZE : 0;
+    SLSChunk *chunk = acquire_chunk(write_seq);
+    if (NULL != chunk)
+    {
+        used += chunk->len.load(std::memory_order_relaxed);
+        release_chunk(chunk);
+    }
+    return used;
+}
+
+//each thread writes its own slot, readers never share a written cache line.
+void CSLSRecycleArray::update_last_read_time()
+{
+    if (t_reader_slot < 0)
     {
-        spdlog::warn("[{}] CSLSRecycleArray::get, read_id->nReadPos={:d}, but m_nDataSize={:d}.",
-                     fmt::ptr(this), read_id->nReadPos, m_nDataSize);
-        read_id->nReadPos = 0;
+        t_reader_slot = g_reader_slot.fetch_add(1, std::memory_order_relaxed) % SLS_READER_SLOT_COUNT;
+    }
+    int64_t cur_time = sls_gettime_ms();
+    std::atomic<int64_t> &last_read_time = m_reader_slots[t_reader_slot].last_read_time;
+    if (last_read_time.load(std::memory_order_relaxed) != cur_time)
+    {
+        last_read_time.store(cur_time, std::memory_order_relaxed);
     }
-    read_id->nDataCount = m_nDataCount;
-    spdlog::trace("[{}] CSLSRecycleArray::get, copy_data_lens={:d}.",
-                  fmt::ptr(this), copy_data_len);
-    return copy_data_len;
 }
 
 int64_t CSLSRecycleArray::get_last_read_time()
 {
-    return m_last_read_time;
+    int64_t last_read_time = 0;
+    for (int i = 0; i < SLS_READER_SLOT_COUNT; i++)
+    {
+        int64_t t = m_reader_slots[i].last_read_time.load(std::memory_order_relaxed);
+        if (t > last_read_time)
+            last_read_time = t;
+    }
+    return last_read_time;
 }
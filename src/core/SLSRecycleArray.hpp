@@ -24,18 +24,92 @@
 
 #pragma once
 
+#include <atomic>
+
 #include "common.hpp"
 #include "SLSLock.hpp"
+#include "SLSRingArena.hpp"
+
+const int SLS_READER_SLOT_COUNT = 16;       //per thread reader activity slots of a ring
+const int SLS_KEYFRAME_COUNT = 64;          //recent keyframes indexed by a ring
+const int SLS_CACHE_LINE_SIZE = 64;
+const int SLS_GOP_SAMPLE_COUNT = 8;         //recent keyframes used to measure the gop duration
+const int SLS_MSG_HEADER_LEN = 2;           //length prefix of a message in message mode
+
+/**
+ * SLSChunkView, a read only range of a chunk, holds one reference of the chunk.
+ */
+struct SLSChunkView
+{
+    SLSChunk *chunk;
+    int offset;
+    int len;
+};
 
 struct SLSRecycleArrayID
 {
-    int nReadPos;
-    int nDataCount;
+    int64_t nChunkSeq;
+    int nChunkPos;
+    int64_t nByteSeq; //stream byte sequence of the next read
+    int64_t nOverrun; //times the reader has been lapped by the writer
+    int64_t nDiscontinuity; //publisher resumes seen by the reader
     bool bFirst;
+    bool bKeyFrameStart; //start from the last keyframe instead of the write pos
+    bool bTsInfoPending; //sps and pps are sent before the next data, the views were full
+};
+
+/**
+ * SLSRingConf, per stream ring settings from the app conf.
+ * the ring is resized between min_size and max_size to keep
+ * two gops plus latency of data, 0 means the default size.
+ * in message mode each message is stored with a length prefix,
+ * so readers get exactly the messages of the publisher.
+ */
+struct SLSRingConf
+{
+    int min_size; //bytes
+    int max_size; //bytes
+    int latency;  //ms
+    bool message_mode;
+};
+
+//the length prefix of a message, little endian.
+inline void sls_set_msg_len(char *data, int len)
+{
+    data[0] = (char)(len & 0xFF);
+    data[1] = (char)((len >> 8) & 0xFF);
+}
+
+inline int sls_get_msg_len(const char *data)
+{
+    return (uint8_t)data[0] | ((uint8_t)data[1] << 8);
+}
+
+/**
+ * SLSKeyFrame, the ring position where a keyframe starts.
+ */
+struct SLSKeyFrame
+{
+    std::atomic<int64_t> chunk_seq;
+    std::atomic<int> chunk_pos;
+    std::atomic<int64_t> time_ms;
+};
+
+/**
+ * SLSReaderSlot, the last read time of the readers in one thread,
+ * each slot owns a cache line so that readers never share a written line.
+ */
+struct alignas(SLS_CACHE_LINE_SIZE) SLSReaderSlot
+{
+    std::atomic<int64_t> last_read_time;
 };
 
 /**
  * CSLSRecycleArray
+ * single producer, multi consumer ring, in lock free mode the producer
+ * publishes m_nWriteSeq and each chunk is validated by its seq like a seqlock.
+ * the slot array is allocated for the max size, only the last m_nActiveCount
+ * chunks are kept, so resizing never moves a chunk and read ids stay valid.
  */
 class CSLSRecycleArray
 {
@@ -44,20 +118,56 @@ public:
     ~CSLSRecycleArray();
 
 public:
-    int put(char *data, int len);
-    int get(char *dst, int size, SLSRecycleArrayID *read_id, int aligned = 0);
+    int put(char *data, int len, int keyframe_pos = -1);
+    char *reserve(int len, int *avail = NULL);
+    int commit(int len, int keyframe_pos = -1, int64_t cur_time_ms = 0);
+    int get(SLSChunkView *views, int &view_count, SLSRecycleArrayID *read_id, int aligned = 0);
 
-    void setSize(int n);
-    int count();
+    void set_conf(const SLSRingConf *conf);
+    void set_lock_free(bool lock_free);
+    bool is_message_mode();
+    int64_t count();
+
+    void adapt_size(int kbitrate);
+    int get_size();
+    int64_t get_used();
 
     int64_t get_last_read_time();
 
+    static SLSChunk *alloc_chunk(int capacity);
+    static void add_ref_chunk(SLSChunk *chunk);
+    static bool try_add_ref_chunk(SLSChunk *chunk);
+    static void release_chunk(SLSChunk *chunk);
+    static void release_views(SLSChunkView *views, int view_count);
+
 private:
-    char *m_arrayData;
-    int m_nDataSize;
-    int m_nDataCount;
-    int m_nWritePos;
-    int64_t m_last_read_time;
+    std::atomic<SLSChunk *> *m_arrayChunk;
+    int m_nChunkCount;  //slots, for the max size
+    int m_nMinCount;
+    std::atomic<int> m_nActiveCount; //chunks kept in the ring
+    std::atomic<int64_t> m_nTrimSeq; //the oldest kept chunk
+    int m_nReserveLen;                //reserved by the producer, not committed yet
+    int m_latency;
+    std::atomic<int64_t> m_nDataCount;
+    std::atomic<int64_t> m_nWriteSeq;
+    int64_t m_ring_id;
+    bool m_lock_free;
+    bool m_message_mode; //messages are length prefixed and never split by get
+
+    SLSReaderSlot m_reader_slots[SLS_READER_SLOT_COUNT];
+
+    SLSKeyFrame m_keyframes[SLS_KEYFRAME_COUNT];
+    std::atomic<int64_t> m_nKeyFrameCount;
 
     CSLSRWLock m_rwclock;
+
+    SLSChunk *prepare_chunk(int64_t seq);
+    SLSChunk *acquire_chunk(int64_t seq);
+    int64_t sync_read_id(SLSRecycleArrayID *read_id, bool keyframe = false);
+    void add_keyframe(int64_t chunk_seq, int chunk_pos, int64_t cur_time_ms);
+    bool get_last_keyframe(int64_t write_seq, int64_t &chunk_seq, int &chunk_pos);
+    int64_t get_gop_duration();
+    void trim_chunks(int64_t seq);
+    void free_chunks();
+    void update_last_read_time();
 };
@@ -259,6 +259,13 @@ int CSLSRelay::open(const char *srt_url)
         spdlog::error("[{}] CSLSRelay::open, srt_setsockopt SRTO_RCVBUF failure. err={}.", fmt::ptr(this), srt_getlasterror_str());
         return SLS_ERROR;
     }
+    //pushers may send whole messages of a stream in message mode.
+    int payload_size = SRT_LIVE_MAX_PAYLOAD_LEN;
+    status = srt_setsockopt(fd, SOL_SOCKET, SRTO_PAYLOADSIZE, &payload_size, sizeof(payload_size));
+    if (status < 0) {
+        spdlog::error("[{}] CSLSRelay::open, srt_setsockopt SRTO_PAYLOADSIZE failure. err={}.", fmt::ptr(this), srt_getlasterror_str());
+        return SLS_ERROR;
+    }
 
     // srt_setsockflag(fd, SRTO_SENDER, &m_is_write, sizeof m_is_write);
     /*
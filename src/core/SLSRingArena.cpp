@@ -0,0 +1,281 @@
+
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Edward.Wu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "spdlog/spdlog.h"
+
+#include "SLSRingArena.hpp"
+#include "SLSLog.hpp"
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+
+/**
+ * CSLSRingArena class implementation
+ */
+
+thread_local int CSLSRingArena::m_thread_node = -1;
+
+CSLSRingArena *CSLSRingArena::get_instance()
+{
+    static CSLSRingArena arena;
+    return &arena;
+}
+
+CSLSRingArena::CSLSRingArena()
+{
+    for (int i = 0; i < SLS_ARENA_MAX_NODES; i++)
+    {
+        m_classes[i][0].size = SLS_MSG_CHUNK_SIZE;
+        m_classes[i][1].size = SLS_CHUNK_SIZE;
+        m_node_bytes[i] = 0;
+    }
+    m_hugepage = false;
+    m_numa = false;
+
+    m_mapped_bytes = 0;
+    m_hugepage_bytes = 0;
+    m_used_bytes = 0;
+    m_alloc_count = 0;
+    m_grow_count = 0;
+}
+
+//the chunks are never given back to the system, see SLSChunk.
+CSLSRingArena::~CSLSRingArena()
+{
+}
+
+//only affects the blocks mapped later.
+void CSLSRingArena::set_hugepage(bool hugepage)
+{
+    m_hugepage = hugepage;
+}
+
+//only affects the blocks mapped later, please call this function before reserve.
+void CSLSRingArena::set_numa(bool numa)
+{
+    m_numa = numa;
+}
+
+//called by each worker thread once it runs on its cpus.
+void CSLSRingArena::set_thread_node(int node)
+{
+    m_thread_node = node;
+}
+
+//the node of the calling thread, node 0 holds all chunks with numa off.
+int CSLSRingArena::get_node()
+{
+    if (m_numa && m_thread_node >= 0 && m_thread_node < SLS_ARENA_MAX_NODES)
+        return m_thread_node;
+    return 0;
+}
+
+//map and touch enough ring chunks of the node at start, so that new publishers
+//don't page fault on the hot path.
+int CSLSRingArena::reserve(int64_t size, int node)
+{
+    if (node < 0 || node >= SLS_ARENA_MAX_NODES || !m_numa)
+        node = 0;
+    SLSArenaClass *size_class = &m_classes[node][SLS_ARENA_CLASS_COUNT - 1];
+    CSLSLock lock(&size_class->mutex);
+    while (m_node_bytes[node].load() < size)
+    {
+        if (SLS_OK != grow(size_class, SLS_ARENA_CLASS_COUNT - 1, node, true))
+        {
+            return SLS_ERROR;
+        }
+    }
+    spdlog::info("[{}] CSLSRingArena::reserve, size={:d}, node={:d}, mapped_bytes={:d}, hugepage_bytes={:d}.",
+                 fmt::ptr(this), size, node, m_mapped_bytes.load(), m_hugepage_bytes.load());
+    return SLS_OK;
+}
+
+int CSLSRingArena::get_size_class(int capacity)
+{
+    for (int i = 0; i < SLS_ARENA_CLASS_COUNT; i++)
+    {
+        if (capacity <= m_classes[0][i].size)
+            return i;
+    }
+    return -1;
+}
+
+SLSChunk *CSLSRingArena::alloc_chunk(int capacity)
+{
+    int index = get_size_class(capacity);
+    if (index < 0)
+    {
+        //chunks are never given back, so there is no heap fallback for larger ones.
+        spdlog::error("[{}] CSLSRingArena::alloc_chunk, no size class for capacity={:d}.",
+                      fmt::ptr(this), capacity);
+        return NULL;
+    }
+    int node = get_node();
+    SLSArenaClass *size_class = &m_classes[node][index];
+    SLSChunk *chunk = NULL;
+    {
+        CSLSLock lock(&size_class->mutex);
+        if (size_class->free_chunks.empty())
+        {
+            m_grow_count++;
+            grow(size_class, index, node, false);
+        }
+        chunk = size_class->free_chunks.back();
+        size_class->free_chunks.pop_back();
+    }
+    m_used_bytes.fetch_add(chunk->capacity, std::memory_order_relaxed);
+    m_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    chunk->len = 0;
+    chunk->ref = 1;
+    return chunk;
+}
+
+void CSLSRingArena::free_chunk(SLSChunk *chunk)
+{
+    m_used_bytes.fetch_sub(chunk->capacity, std::memory_order_relaxed);
+    chunk->seq = -1;
+    chunk->ring_id = 0;
+    SLSArenaClass *size_class = &m_classes[chunk->node][chunk->size_class];
+    CSLSLock lock(&size_class->mutex);
+    size_class->free_chunks.push_back(chunk);
+}
+
+//the class lock must be held, split a new block into free chunks.
+int CSLSRingArena::grow(SLSArenaClass *size_class, int index, int node, bool populate)
+{
+    char *block = map_block(node, populate);
+    if (NULL == block)
+    {
+        //keep serving from the heap, the block is never freed either.
+        block = new char[SLS_ARENA_BLOCK_SIZE];
+    }
+    int count = SLS_ARENA_BLOCK_SIZE / size_class->size;
+    for (int i = 0; i < count; i++)
+    {
+        SLSChunk *chunk = new SLSChunk;
+        chunk->data = block + i * size_class->size;
+        chunk->capacity = size_class->size;
+        chunk->size_class = index;
+        chunk->node = node;
+        chunk->len = 0;
+        chunk->seq = -1;
+        chunk->byte_seq = 0;
+        chunk->ring_id = 0;
+        chunk->ref = 0;
+        size_class->free_chunks.push_back(chunk);
+    }
+    spdlog::debug("[{}] CSLSRingArena::grow, size={:d}, count={:d}, node={:d}, mapped_bytes={:d}.",
+                  fmt::ptr(this), size_class->size, count, node, m_mapped_bytes.load());
+    return SLS_OK;
+}
+
+char *CSLSRingArena::map_block(int node, bool populate)
+{
+    void *p = MAP_FAILED;
+    bool hugetlb = false;
+#ifdef MAP_HUGETLB
+    if (m_hugepage)
+    {
+        p = mmap(NULL, SLS_ARENA_BLOCK_SIZE, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        hugetlb = (p != MAP_FAILED);
+    }
+#endif
+    if (p == MAP_FAILED)
+    {
+        //map twice the size, then trim it to a huge page aligned block for THP.
+        size_t map_size = SLS_ARENA_BLOCK_SIZE * 2;
+        char *base = (char *)mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+                                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if ((void *)base == MAP_FAILED)
+        {
+            spdlog::error("[{}] CSLSRingArena::map_block, mmap failed, errno={:d}.", fmt::ptr(this), errno);
+            return NULL;
+        }
+        uintptr_t aligned = ((uintptr_t)base + SLS_ARENA_BLOCK_SIZE - 1) & ~(uintptr_t)(SLS_ARENA_BLOCK_SIZE - 1);
+        size_t head = aligned - (uintptr_t)base;
+        if (head > 0)
+            munmap(base, head);
+        if (map_size - head > (size_t)SLS_ARENA_BLOCK_SIZE)
+            munmap((char *)aligned + SLS_ARENA_BLOCK_SIZE, map_size - head - SLS_ARENA_BLOCK_SIZE);
+        p = (void *)aligned;
+#ifdef MADV_HUGEPAGE
+        if (m_hugepage)
+            madvise(p, SLS_ARENA_BLOCK_SIZE, MADV_HUGEPAGE);
+#endif
+    }
+#ifdef SYS_mbind
+    //prefer the node before any page of the block is touched.
+    if (m_numa)
+    {
+        unsigned long node_mask = 1UL << node;
+        if (syscall(SYS_mbind, p, SLS_ARENA_BLOCK_SIZE, MPOL_PREFERRED, &node_mask, SLS_ARENA_MAX_NODES + 1, 0) != 0)
+        {
+            spdlog::warn("[{}] CSLSRingArena::map_block, mbind failed, node={:d}, errno={:d}.", fmt::ptr(this), node, errno);
+        }
+    }
+#endif
+    if (populate)
+    {
+        memset(p, 0, SLS_ARENA_BLOCK_SIZE);
+    }
+    m_mapped_bytes += SLS_ARENA_BLOCK_SIZE;
+    m_node_bytes[node] += SLS_ARENA_BLOCK_SIZE;
+    if (hugetlb)
+        m_hugepage_bytes += SLS_ARENA_BLOCK_SIZE;
+    return (char *)p;
+}
+
+void CSLSRingArena::get_stat(SLSArenaStat *stat)
+{
+    stat->mapped_bytes = m_mapped_bytes.load(std::memory_order_relaxed);
+    stat->hugepage_bytes = m_hugepage_bytes.load(std::memory_order_relaxed);
+    stat->used_bytes = m_used_bytes.load(std::memory_order_relaxed);
+    stat->alloc_count = m_alloc_count.load(std::memory_order_relaxed);
+    stat->grow_count = m_grow_count.load(std::memory_order_relaxed);
+    stat->free_bytes = 0;
+    for (int node = 0; node < SLS_ARENA_MAX_NODES; node++)
+    {
+        stat->node_bytes[node] = m_node_bytes[node].load(std::memory_order_relaxed);
+        for (int i = 0; i < SLS_ARENA_CLASS_COUNT; i++)
+        {
+            CSLSLock lock(&m_classes[node][i].mutex);
+            stat->free_bytes += (int64_t)m_classes[node][i].free_chunks.size() * m_classes[node][i].size;
+        }
+    }
+
+    struct rusage usage;
+    memset(&usage, 0, sizeof(usage));
+    getrusage(RUSAGE_SELF, &usage);
+    stat->minor_faults = usage.ru_minflt;
+    stat->major_faults = usage.ru_majflt;
+}
@@ -0,0 +1,120 @@
+
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Edward.Wu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include "common.hpp"
+#include "SLSLock.hpp"
+
+const int SLS_CHUNK_SIZE = 16 * TS_UDP_LEN;         //data size of one ring chunk
+const int SLS_MSG_CHUNK_SIZE = 2048;               //one srt message with its length prefix
+const int SLS_ARENA_BLOCK_SIZE = 2 * 1024 * 1024;  //mapped at a time, one huge page
+const int SLS_ARENA_CLASS_COUNT = 2;               //SLS_MSG_CHUNK_SIZE and SLS_CHUNK_SIZE
+const int SLS_ARENA_MAX_NODES = 8;                 //numa nodes with their own free chunks
+
+/**
+ * SLSChunk, an append only block of the ring,
+ * shared by the ring and all readers still sending from it.
+ * ring chunks are never given back to the system, so a reader may
+ * safely try to reference a chunk which has just been recycled.
+ */
+struct SLSChunk
+{
+    char *data;
+    int capacity;
+    int size_class;               //arena size class
+    int node;                     //arena node whose free chunks it returns to
+    std::atomic<int> len;         //written bytes, data[0, len) never changes until the chunk is recycled
+    std::atomic<int64_t> seq;     //chunk sequence in the ring, -1 while the chunk is being recycled
+    std::atomic<int64_t> byte_seq; //stream byte sequence of data[0]
+    std::atomic<int64_t> ring_id; //the ring which the chunk belongs to
+    std::atomic<int> ref;
+};
+
+struct SLSArenaStat
+{
+    int64_t mapped_bytes;   //bytes mapped from the system
+    int64_t hugepage_bytes; //bytes of mapped huge pages
+    int64_t used_bytes;     //bytes of the chunks in use
+    int64_t free_bytes;     //bytes of the free chunks
+    int64_t alloc_count;    //chunks handed out
+    int64_t grow_count;     //blocks mapped on demand after reserve
+    int64_t minor_faults;   //page faults of the process
+    int64_t major_faults;
+    int64_t node_bytes[SLS_ARENA_MAX_NODES]; //bytes mapped on each numa node
+};
+
+/**
+ * CSLSRingArena
+ * process wide pool of ring chunks, the data of each size class is carved
+ * from blocks mapped once, optionally backed by huge pages, and is reused
+ * by all rings across publisher reconnects and reloads.
+ * with numa on, each node has its own blocks, and a ring takes its chunks
+ * from the node of the worker thread which writes it.
+ */
+class CSLSRingArena
+{
+public:
+    static CSLSRingArena *get_instance();
+
+    void set_hugepage(bool hugepage);
+    void set_numa(bool numa);
+    int reserve(int64_t size, int node = -1);
+    static void set_thread_node(int node);
+
+    SLSChunk *alloc_chunk(int capacity); //NULL above SLS_CHUNK_SIZE
+    void free_chunk(SLSChunk *chunk);
+
+    void get_stat(SLSArenaStat *stat);
+
+private:
+    CSLSRingArena();
+    ~CSLSRingArena();
+
+    struct SLSArenaClass
+    {
+        int size;
+        std::vector<SLSChunk *> free_chunks;
+        CSLSMutex mutex;
+    };
+    SLSArenaClass m_classes[SLS_ARENA_MAX_NODES][SLS_ARENA_CLASS_COUNT];
+    bool m_hugepage;
+    bool m_numa;
+    static thread_local int m_thread_node; //numa node of the calling worker, -1: unknown
+
+    std::atomic<int64_t> m_mapped_bytes;
+    std::atomic<int64_t> m_hugepage_bytes;
+    std::atomic<int64_t> m_used_bytes;
+    std::atomic<int64_t> m_alloc_count;
+    std::atomic<int64_t> m_grow_count;
+    std::atomic<int64_t> m_node_bytes[SLS_ARENA_MAX_NODES];
+
+    int get_size_class(int capacity);
+    int get_node();
+    int grow(SLSArenaClass *size_class, int index, int node, bool populate);
+    char *map_block(int node, bool populate);
+};
@@ -47,6 +47,7 @@ CSLSRole::CSLSRole()
     m_stat_bitrate_datacount = 0;
     m_kbitrate = 0;              //kb
     m_idle_streams_timeout = 10; //unit: s, -1: unlimited
+    m_stall_timeout = 0;
     m_latency = 20;              //ms
 
     m_state = SLS_RS_UNINIT;
@@ -63,10 +64,16 @@ CSLSRole::CSLSRole()
     m_map_data = NULL;
     memset(m_map_data_key, 0, URL_MAX_LEN);
     memset(&m_map_data_id, 0, sizeof(SLSRecycleArrayID));
-
-    memset(m_data, 0, DATA_BUFF_SIZE);
-    m_data_len = 0;
-    m_data_pos = 0;
+    CSLSTimeShift::init_id(&m_timeshift_id, 0);
+    m_stream = NULL;
+    m_subscriber.fd = -1;
+    m_subscriber.queue = NULL;
+    m_subscriber.pending = false;
+    m_armed = true;
+
+    memset(m_data_views, 0, sizeof(m_data_views));
+    m_data_view_count = 0;
+    m_data_view_pos = 0;
     m_need_reconnect = false;
     m_http_client = NULL;
 
@@ -94,8 +101,17 @@ int CSLSRole::init()
     m_state = SLS_RS_INITED;
 
     m_map_data_id.bFirst = true;
-    m_map_data_id.nDataCount = 0;
-    m_map_data_id.nReadPos = 0;
+    m_map_data_id.nChunkSeq = 0;
+    m_map_data_id.nChunkPos = 0;
+    m_map_data_id.nByteSeq = 0;
+    m_map_data_id.nOverrun = 0;
+    m_map_data_id.nDiscontinuity = 0;
+    m_map_data_id.bTsInfoPending = false;
+    m_parked = false;
+    m_stream_waiting = false;
+    m_wait_stream_timeout = 0;
+    m_wait_stream_begin_tm = 0;
+    m_map_data_id.bKeyFrameStart = false;
 
     return ret;
 }
@@ -118,6 +134,18 @@ int CSLSRole::uninit()
     }
     close_hls_file();
 
+    CSLSRecycleArray::release_views(m_data_views, m_data_view_count);
+    m_data_view_count = m_data_view_pos = 0;
+    CSLSTimeShift::close_id(&m_timeshift_id);
+
+    unwait_stream();
+    if (m_stream)
+    {
+        m_stream->unsubscribe(&m_subscriber);
+        m_stream->release();
+        m_stream = NULL;
+    }
+
     return ret;
 }
 
@@ -210,9 +238,10 @@ int CSLSRole::add_to_epoll(int eid)
     if (m_srt)
     {
         m_srt->libsrt_set_eid(eid);
-        ret = m_srt->libsrt_add_to_epoll(eid, m_is_write);
-        spdlog::info("[{}] CSLSRole::add_to_epoll, {}, sock={:d}, m_is_write={:d}, ret={:d}.",
-                     fmt::ptr(this), m_role_name, get_fd(), m_is_write, ret);
+        ret = m_srt->libsrt_add_to_epoll(eid, m_is_write, !m_parked);
+        m_armed = !m_parked;
+        spdlog::info("[{}] CSLSRole::add_to_epoll, {}, sock={:d}, m_is_write={:d}, m_parked={:d}, ret={:d}.",
+                     fmt::ptr(this), m_role_name, get_fd(), m_is_write, m_parked, ret);
     }
     return ret;
 }
@@ -271,6 +300,7 @@ void CSLSRole::set_map_data(const char *map_key, CSLSMapData *map_data)
     {
         strlcpy(m_map_data_key, map_key, sizeof(m_map_data_key));
         m_map_data = map_data;
+        attach_stream();
     }
     else
     {
@@ -278,11 +308,230 @@ void CSLSRole::set_map_data(const char *map_key, CSLSMapData *map_data)
     }
 }
 
+const char *CSLSRole::get_map_data_key()
+{
+    return m_map_data_key;
+}
+
+//the writers attached to the stream of the role in any worker.
+int CSLSRole::get_stream_viewers()
+{
+    return m_stream ? m_stream->get_subscriber_count() : 0;
+}
+
+//resolve the stream data of the key once, the data path uses it without any map lookup.
+int CSLSRole::attach_stream()
+{
+    if (m_stream)
+    {
+        if (!m_stream->is_removed())
+            return SLS_OK;
+        //the publisher is gone, follow the new stream of the key from its start.
+        m_stream->unsubscribe(&m_subscriber);
+        m_stream->release();
+        m_stream = NULL;
+        m_map_data_id.bFirst = true;
+        CSLSTimeShift::close_id(&m_timeshift_id);
+        CSLSTimeShift::init_id(&m_timeshift_id, m_timeshift_id.shift);
+    }
+    if (NULL == m_map_data)
+        return SLS_ERROR;
+    m_stream = m_map_data->acquire(m_map_data_key);
+    if (NULL == m_stream)
+        return SLS_ERROR;
+    if (m_is_write && m_subscriber.queue)
+    {
+        m_stream->subscribe(&m_subscriber);
+    }
+    spdlog::trace("[{}] CSLSRole::attach_stream, key={}, stream={}.", fmt::ptr(this), m_map_data_key, fmt::ptr(m_stream));
+    return SLS_OK;
+}
+
+void CSLSRole::set_gop_cache(bool gop_cache)
+{
+    m_map_data_id.bKeyFrameStart = gop_cache;
+}
+
+//called by the group once the role is in its epoll, a writer is signaled by its stream from now on.
+void CSLSRole::set_ready_queue(CSLSReadyQueue *queue)
+{
+    m_subscriber.fd = get_fd();
+    m_subscriber.queue = queue;
+    //a signal left in the queue of the previous worker is lost, the first poll catches up.
+    m_subscriber.pending = false;
+    if (m_is_write && m_stream)
+    {
+        m_stream->subscribe(&m_subscriber);
+    }
+    if (m_parked)
+    {
+        wait_stream();
+    }
+}
+
+//called by the group before the role is moved to another worker,
+//the socket keeps its data and the role its read position until it is added again.
+int CSLSRole::leave_worker()
+{
+    unwait_stream();
+    if (m_stream)
+    {
+        m_stream->unsubscribe(&m_subscriber);
+    }
+    m_subscriber.queue = NULL;
+    return remove_from_epoll();
+}
+
+//called by the group when the stream of the role has new data.
+int CSLSRole::handler_ready()
+{
+    //cleared before reading, so data committed from now on signals the role again.
+    m_subscriber.pending.exchange(false);
+    if (m_parked)
+    {
+        //a publisher of the key appeared.
+        check_parked(sls_gettime_ms(), true);
+        return SLS_OK;
+    }
+    return handler();
+}
+
+//the stream of the writer is gone, check_parked attaches it to the next one.
+void CSLSRole::park()
+{
+    if (m_parked)
+        return;
+    m_parked = true;
+    m_wait_stream_begin_tm = sls_gettime_ms();
+    set_armed(false);
+    wait_stream();
+}
+
+//register the parked writer as a waiter of its key, it is signaled by CSLSMapData::add.
+void CSLSRole::wait_stream()
+{
+    if (m_stream_waiting || !m_is_write || NULL == m_subscriber.queue || NULL == m_map_data)
+        return;
+    m_map_data->wait(m_map_data_key, &m_subscriber);
+    m_stream_waiting = true;
+    //the publisher may have appeared before the role was registered.
+    if (m_map_data->is_exist(m_map_data_key) && !m_subscriber.pending.exchange(true))
+    {
+        m_subscriber.queue->push(m_subscriber.fd);
+    }
+}
+
+void CSLSRole::unwait_stream()
+{
+    if (!m_stream_waiting)
+        return;
+    m_map_data->unwait(m_map_data_key, &m_subscriber);
+    m_stream_waiting = false;
+}
+
+//a writer is only polled for write while it has data to send,
+//and no role is polled while its on_connect call is pending.
+void CSLSRole::set_armed(bool armed)
+{
+    if (armed == m_armed || NULL == m_srt)
+        return;
+    if (m_srt->libsrt_update_epoll(m_is_write, armed) >= 0)
+    {
+        m_armed = armed;
+    }
+}
+
+//play the stream shift ms behind the live edge.
+void CSLSRole::set_timeshift(int64_t shift)
+{
+    CSLSTimeShift::close_id(&m_timeshift_id);
+    CSLSTimeShift::init_id(&m_timeshift_id, shift);
+}
+
+bool CSLSRole::is_timeshift()
+{
+    return m_timeshift_id.shift > 0;
+}
+
 void CSLSRole::set_idle_streams_timeout(int timeout)
 {
     m_idle_streams_timeout = timeout;
 }
 
+//park the role if its stream doesn't exist yet, it is attached by check_parked.
+void CSLSRole::set_wait_stream_timeout(int timeout)
+{
+    m_wait_stream_timeout = timeout;
+    if (timeout > 0 && NULL == m_stream)
+    {
+        m_parked = true;
+        m_wait_stream_begin_tm = sls_gettime_ms();
+    }
+}
+
+bool CSLSRole::is_parked()
+{
+    return m_parked;
+}
+
+//the role waits for its on_connect call, the group checks it more often.
+//a parked role is signaled when its stream is live, only its timeout is checked.
+bool CSLSRole::is_waiting()
+{
+    return !m_http_passed || (m_parked && !m_stream_waiting);
+}
+
+//called by the group, return SLS_OK once the role is attached,
+//SLS_ERROR when it's still waiting or the wait is timeout.
+//a registered waiter only tries to attach when it is signaled.
+int CSLSRole::check_parked(int64_t cur_time_ms, bool signaled)
+{
+    if (!m_parked)
+        return SLS_OK;
+
+    if ((signaled || !m_stream_waiting) && SLS_OK == attach_stream())
+    {
+        unwait_stream();
+        m_parked = false;
+        m_invalid_begin_tm = cur_time_ms;
+        int ret = m_srt ? m_srt->libsrt_update_epoll(m_is_write) : SLS_ERROR;
+        m_armed = true;
+        spdlog::info("[{}] CSLSRole::check_parked, {}, key={}, stream is live after {:d}ms, ret={:d}.",
+                     fmt::ptr(this), m_role_name, m_map_data_key, cur_time_ms - m_wait_stream_begin_tm, ret);
+        return SLS_OK;
+    }
+
+    if (m_wait_stream_timeout <= 0)
+    {
+        //the stream is gone, the idle timeout applies.
+        return SLS_ERROR;
+    }
+    if (cur_time_ms - m_wait_stream_begin_tm >= m_wait_stream_timeout)
+    {
+        spdlog::info("[{}] CSLSRole::check_parked, {}, key={}, no stream in {:d}ms, call invalid_srt.",
+                     fmt::ptr(this), m_role_name, m_map_data_key, m_wait_stream_timeout);
+        unwait_stream();
+        m_parked = false;
+        m_state = SLS_RS_INVALID;
+        invalid_srt();
+        return SLS_ERROR;
+    }
+    //the idle timeout doesn't apply while waiting.
+    m_invalid_begin_tm = cur_time_ms;
+    return SLS_ERROR;
+}
+
+//called by the group, the role is armed again once its on_connect call passed.
+void CSLSRole::check_http_wait()
+{
+    if (m_armed || m_parked || m_http_passed)
+        return;
+    if (SLS_OK == check_http_passed())
+    {
+        set_armed(true);
+    }
+}
+
 bool CSLSRole::check_idle_streams_duration(int64_t cur_time_ms)
 {
     if (-1 == m_idle_streams_timeout)
@@ -293,6 +542,12 @@ bool CSLSRole::check_idle_streams_duration(int64_t cur_time_ms)
     {
         cur_time_ms = sls_gettime_ms();
     }
+    //a writer sleeping on a live stream is as busy as its publisher,
+    //a held stream has no publisher, its writers go idle.
+    if (!m_armed && !m_parked && m_http_passed && NULL != m_stream && !m_stream->is_removed() && !m_stream->is_held())
+    {
+        m_invalid_begin_tm = cur_time_ms;
+    }
     int duration = cur_time_ms - m_invalid_begin_tm;
     if (duration >= m_idle_streams_timeout * 1000)
     {
@@ -458,10 +713,10 @@ void CSLSRole::check_hls_file()
     if (m_record_hls_ts_fd)
     {
         //write sps pps
-        if (m_map_data)
+        if (m_stream)
         {
             char ts_info[TS_UDP_LEN] = {0};
-            int re = m_map_data->get_ts_info(m_map_data_key, ts_info, TS_UDP_LEN);
+            int re = m_stream->get_ts_info(ts_info, TS_UDP_LEN);
             if (re > 0)
             {
                 ::write(m_record_hls_ts_fd, ts_info, re);
@@ -497,10 +752,10 @@ void CSLSRole::record_data2hls(char *data, int len)
 
 int CSLSRole::handler_read_data(int64_t *last_read_time)
 {
-    char szData[TS_UDP_LEN];
-
     if (SLS_OK != check_http_passed())
     {
+        //polled by check_http_wait instead.
+        set_armed(false);
         return SLS_OK;
     }
 
@@ -509,46 +764,108 @@ int CSLSRole::handler_read_data(int64_t *last_read_time)
         spdlog::error("[{}] CSLSRole::handler_read_data, m_srt is null.", fmt::ptr(this));
         return SLS_ERROR;
     }
-    //read data
-    int n = m_srt->libsrt_read(szData, TS_UDP_LEN);
-    if (n <= 0)
+
+    if (NULL == m_stream)
     {
-        spdlog::error("[{}] CSLSRole::handler_read_data, libsrt_read failure, n={:d}, expected={:d}.", fmt::ptr(this), n, TS_UDP_LEN);
+        spdlog::error("[{}] CSLSRole::handler_read_data, no data handled, m_stream is NULL.", fmt::ptr(this));
         return SLS_ERROR;
     }
 
-    m_stat_bitrate_datacount += n;
-    //update invalid begin time
-    m_invalid_begin_tm = sls_gettime_ms();
-    int d = m_invalid_begin_tm - m_stat_bitrate_last_tm;
-    if (d >= m_stat_bitrate_interval)
+    //one clock read for the whole batch.
+    int64_t cur_time_ms = sls_gettime_ms();
+    if (!m_stream->claim_ingest(this, m_stall_timeout, cur_time_ms))
     {
-        m_kbitrate = m_stat_bitrate_datacount * 8 / d;
-        m_stat_bitrate_datacount = 0;
-        m_stat_bitrate_last_tm = m_invalid_begin_tm;
+        //a standby publisher, keep the socket drained until it takes the ring over.
+        return handler_standby_data();
     }
-
-    if (n != TS_UDP_LEN)
+    CSLSLock lock(m_stream->get_ingest_mutex());
+    if (!m_stream->is_ingest_owner(this))
     {
-        spdlog::trace("[{}] CSLSRole::handler_read_data, libsrt_read n={:d}, expect {:d}.", fmt::ptr(this), n, TS_UDP_LEN);
+        //taken over meanwhile.
+        return SLS_OK;
     }
 
-    if (NULL == m_map_data)
+    //drain the socket into the stream ring directly, each filled chunk is committed once,
+    //in message mode every message is stored behind its length.
+    bool message_mode = m_stream->is_message_mode();
+    int header_len = message_mode ? SLS_MSG_HEADER_LEN : 0;
+    int msg_len = message_mode ? SRT_LIVE_MAX_PAYLOAD_LEN : TS_UDP_LEN;
+    int read_size = 0;
+    int read_count = 0;
+    int n = 0;
+    while (read_count < READ_BATCH_BUDGET)
     {
-        spdlog::error("[{}] CSLSRole::handler_read_data, no data handled, m_map_data is NULL.", fmt::ptr(this));
-        return SLS_ERROR;
+        int avail = 0;
+        char *data = m_stream->reserve(header_len + msg_len, &avail);
+        if (NULL == data)
+        {
+            spdlog::error("[{}] CSLSRole::handler_read_data, m_stream->reserve failed.", fmt::ptr(this));
+            return SLS_ERROR;
+        }
+        int len = 0;
+        while (read_count < READ_BATCH_BUDGET && avail - len >= header_len + msg_len)
+        {
+            n = m_srt->libsrt_read(data + len + header_len, msg_len);
+            if (n <= 0)
+                break;
+            if (n != TS_UDP_LEN)
+            {
+                spdlog::trace("[{}] CSLSRole::handler_read_data, libsrt_read n={:d}, expect {:d}.", fmt::ptr(this), n, TS_UDP_LEN);
+            }
+            if (message_mode)
+            {
+                sls_set_msg_len(data + len, n);
+            }
+            len += header_len + n;
+            read_size += n;
+            read_count++;
+        }
+
+        if (len > 0)
+        {
+            //the data before the first keyframe is dropped when the ring is taken over.
+            len = m_stream->commit(data, len, cur_time_ms, last_read_time);
+            //record data, the committed data stays in place
+            if (len > 0 && strcmp(m_record_hls, "on") == 0)
+            {
+                for (int pos = 0; pos < len;)
+                {
+                    int record_len = message_mode ? sls_get_msg_len(data + pos) : len;
+                    record_data2hls(data + pos + header_len, record_len);
+                    pos += header_len + record_len;
+                }
+            }
+        }
+
+        if (n == SLSERROR(EAGAIN))
+            break;
+        if (n <= 0)
+        {
+            spdlog::error("[{}] CSLSRole::handler_read_data, libsrt_read failure, n={:d}, expected={:d}.", fmt::ptr(this), n, TS_UDP_LEN);
+            return SLS_ERROR;
+        }
     }
 
-    spdlog::trace("[{}] CSLSRole::handler_read_data, ok, libsrt_read n={:d}.", fmt::ptr(this), n);
-    int ret = m_map_data->put(m_map_data_key, szData, n, last_read_time);
+    if (0 == read_size)
+    {
+        return SLS_OK;
+    }
 
-    //record data
-    if (strcmp(m_record_hls, "on") == 0)
+    m_stat_bitrate_datacount += read_size;
+    //update invalid begin time
+    m_invalid_begin_tm = cur_time_ms;
+    m_stream->update_ingest_time(cur_time_ms);
+    int d = m_invalid_begin_tm - m_stat_bitrate_last_tm;
+    if (d >= m_stat_bitrate_interval)
     {
-        record_data2hls(szData, n);
+        m_kbitrate = m_stat_bitrate_datacount * 8 / d;
+        m_stat_bitrate_datacount = 0;
+        m_stat_bitrate_last_tm = m_invalid_begin_tm;
+        m_stream->adapt_ring_size(m_kbitrate);
     }
 
-    return ret;
+    spdlog::trace("[{}] CSLSRole::handler_read_data, ok, read_size={:d}, read_count={:d}.", fmt::ptr(this), read_size, read_count);
+    return read_size;
 }
 
 int CSLSRole::get_statistics(SRT_TRACEBSTATS *currentStats, int clear) {
@@ -568,13 +885,48 @@ int CSLSRole::get_uptime() {
     return difference/1000;
 }
 
+int CSLSRole::get_ring_info(int &size, int64_t &used) {
+    if (m_map_data) {
+        return m_map_data->get_ring_info(m_map_data_key, size, used);
+    }
+    return SLS_ERROR;
+}
+
+//drain the socket of a standby publisher, its data is dropped while another one owns the ring.
+int CSLSRole::handler_standby_data()
+{
+    char data[SRT_LIVE_MAX_PAYLOAD_LEN];
+    int read_size = 0;
+    for (int i = 0; i < READ_BATCH_BUDGET; i++)
+    {
+        int n = m_srt->libsrt_read(data, sizeof(data));
+        if (n == SLSERROR(EAGAIN))
+            break;
+        if (n <= 0)
+        {
+            spdlog::error("[{}] CSLSRole::handler_standby_data, libsrt_read failure, n={:d}.", fmt::ptr(this), n);
+            return SLS_ERROR;
+        }
+        read_size += n;
+    }
+    if (read_size > 0)
+    {
+        //update invalid begin time
+        m_invalid_begin_tm = sls_gettime_ms();
+    }
+    return read_size;
+}
+
 int CSLSRole::handler_write_data()
 {
     int ret = 0;
     int write_size = 0;
+    bool more = false; //the last fetch may have left data in the ring
 
     if (check_http_passed())
     {
+        //polled by check_http_wait instead.
+        set_armed(false);
         return SLS_OK;
     }
 
@@ -592,16 +944,45 @@ int CSLSRole::handler_write_data()
         return SLS_ERROR;
     }
 
-    if (m_data_len < TS_UDP_LEN)
+    if (m_data_view_pos >= m_data_view_count)
     {
-        ret = m_map_data->get(m_map_data_key, m_data, DATA_BUFF_SIZE, &m_map_data_id, TS_UDP_LEN);
+        CSLSRecycleArray::release_views(m_data_views, m_data_view_count);
+        m_data_view_pos = m_data_view_count = 0;
+
+        if (NULL == m_stream || m_stream->is_removed())
+        {
+            if (SLS_OK != attach_stream())
+            {
+                //maybe no publisher, sleep until check_parked finds a new stream or timeout.
+                park();
+                return SLS_OK;
+            }
+        }
+
+        int view_count = DATA_VIEW_COUNT;
+        if (m_timeshift_id.shift > 0 && !m_stream->has_timeshift())
+        {
+            spdlog::warn("[{}] CSLSRole::handler_write_data, key={}, no time shift buffer, play live.",
+                         fmt::ptr(this), m_map_data_key);
+            m_timeshift_id.shift = 0;
+        }
+        if (m_timeshift_id.shift > 0)
+        {
+            ret = m_stream->get_shifted(m_data_views, view_count, &m_timeshift_id);
+        }
+        else
+        {
+            //aligned is ignored in message mode, whole messages are returned.
+            ret = m_stream->get(m_data_views, view_count, &m_map_data_id, TS_UDP_LEN);
+        }
         if (ret < 0)
         {
             //maybe no publisher, wait for timeout.
             return SLS_OK;
         }
-        m_data_pos = 0;
-        m_data_len = ret;
+        m_data_view_count = view_count;
+        //all views filled, the ring may hold more.
+        more = view_count >= DATA_VIEW_COUNT;
     }
 
     m_stat_bitrate_datacount += ret;
@@ -615,36 +996,40 @@ int CSLSRole::handler_write_data()
         m_stat_bitrate_last_tm = m_invalid_begin_tm;
     }
 
-    int len = m_data_len - m_data_pos;
-    int remainer = m_data_len - m_data_pos;
-    while (remainer >= TS_UDP_LEN)
+    //send from the shared chunks directly, the views are released once they are sent out.
+    //in message mode each message is sent as the publisher sent it.
+    bool message_mode = m_stream->is_message_mode();
+    int header_len = message_mode ? SLS_MSG_HEADER_LEN : 0;
+    while (m_data_view_pos < m_data_view_count)
     {
-        ret = write(m_data + m_data_pos, TS_UDP_LEN);
-        if (ret < TS_UDP_LEN)
+        SLSChunkView *view = &m_data_views[m_data_view_pos];
+        while (view->len > 0)
         {
-            spdlog::error("[{}] CSLSRole::handler_write_data, write data failed, len={:d}, ret={:d}, not {:d}.", fmt::ptr(this), len, ret, TS_UDP_LEN);
-            break;
+            char *data = view->chunk->data + view->offset;
+            int len = view->len < TS_UDP_LEN ? view->len : TS_UDP_LEN;
+            if (message_mode)
+            {
+                len = sls_get_msg_len(data);
+            }
+            ret = write(data + header_len, len);
+            if (ret < len)
+            {
+                spdlog::error("[{}] CSLSRole::handler_write_data, write data failed, len={:d}, ret={:d}, remainder={:d}.", fmt::ptr(this), len, ret, view->len);
+                //the rest is sent once the socket is writable.
+                set_armed(true);
+                return write_size;
+            }
+            view->offset += header_len + len;
+            view->len -= header_len + len;
+            write_size += len;
         }
-        m_data_pos += TS_UDP_LEN;
-        write_size += TS_UDP_LEN;
-        remainer = m_data_len - m_data_pos;
-    }
-
-    if (m_data_pos < m_data_len)
-    {
-        spdlog::trace("[{}] CSLSRole::handler_write_data, write data, len={:d}, remainder={:d}.", fmt::ptr(this), len, m_data_len - m_data_pos);
-        return SLS_OK;
-    }
-    if (m_data_pos > m_data_len)
-    {
-        spdlog::error("[{}] CSLSRole::handler_write_data, write data, data error, len={:d}, m_data_pos={:d} > m_data_len={:d}.", fmt::ptr(this), len, m_data_pos, m_data_len);
-    }
-    else
-    {
-        //spdlog::trace("[{}] CSLSRole::handler_write_data, write data, m_data_len={:d}.", fmt::ptr(this), m_data_len);
+        CSLSRecycleArray::release_chunk(view->chunk);
+        view->chunk = NULL;
+        m_data_view_pos++;
     }
-    m_data_pos = m_data_len = 0;
 
+    //a live writer which has sent everything sleeps until the publisher signals new data.
+    set_armed(more || NULL == m_subscriber.queue);
     return write_size;
 }
 
@@ -656,6 +1041,7 @@ void CSLSRole::set_stat_info_base(stat_info_t &v)
 stat_info_t CSLSRole::get_stat_info()
 {
     m_stat_info_base.kbitrate = m_kbitrate;
+    m_stat_info_base.overruns = m_map_data_id.nOverrun + m_timeshift_id.overrun;
     return m_stat_info_base;
 }
 
@@ -41,7 +41,8 @@ enum SLS_ROLE_STATE
     SLS_RS_INVALID = 2,
 };
 
-const int DATA_BUFF_SIZE = 100 * 1316;
+const int DATA_VIEW_COUNT = 8;    //chunk views fetched by one handler_write_data
+const int READ_BATCH_BUDGET = 64; //messages drained by one handler_read_data
 const int UNLIMITED_TIMEOUT = -1;
 /**
  * CSLSRole , the base of player, publisher and listener
@@ -76,10 +77,24 @@ public:
 
     void set_conf(sls_conf_base_t *conf);
     void set_map_data(const char *map_key, CSLSMapData *map_data);
+    const char *get_map_data_key();
+    int get_stream_viewers();
+    void set_gop_cache(bool gop_cache);
+    void set_timeshift(int64_t shift);
+    bool is_timeshift();
+    void set_ready_queue(CSLSReadyQueue *queue);
+    int leave_worker();
+    int handler_ready();
 
     void set_idle_streams_timeout(int timeout);
     bool check_idle_streams_duration(int64_t cur_time_ms = 0);
 
+    void set_wait_stream_timeout(int timeout);
+    bool is_parked();
+    bool is_waiting();
+    int check_parked(int64_t cur_time_ms, bool signaled = false);
+    void check_http_wait();
+
     char *get_streamid();
     bool is_reconnect();
 
@@ -95,6 +110,7 @@ public:
     int get_statistics(SRT_TRACEBSTATS *currentStats, int clear);
     int get_bitrate();
     int get_uptime();
+    int get_ring_info(int &size, int64_t &used);
     int check_http_client();
     int check_http_passed();
 
@@ -110,6 +126,7 @@ protected:
     int m_stat_bitrate_datacount;
     int m_kbitrate;             //kb
     int m_idle_streams_timeout; //unit: s, -1: unlimited
+    int m_stall_timeout;        //ms, a standby publisher takes over the ring of a stalled one, 0: no standby
     int m_latency;              //ms
 
     int m_state;
@@ -126,10 +143,18 @@ protected:
     CSLSMapData *m_map_data;
     char m_map_data_key[URL_MAX_LEN];
     SLSRecycleArrayID m_map_data_id;
-
-    char m_data[DATA_BUFF_SIZE];
-    int m_data_len;
-    int m_data_pos;
+    SLSTimeShiftID m_timeshift_id; //players behind the live edge
+    CSLSStreamData *m_stream;
+    SLSSubscriber m_subscriber;   //a writer sleeps until its stream has new data
+    bool m_armed;
+    bool m_parked;                //waiting for the stream without egress
+    bool m_stream_waiting;        //registered as a waiter of the key, signaled when it is live
+    int m_wait_stream_timeout;    //ms
+    int64_t m_wait_stream_begin_tm;
+
+    SLSChunkView m_data_views[DATA_VIEW_COUNT];
+    int m_data_view_count;
+    int m_data_view_pos;
     bool m_need_reconnect;
     stat_info_t m_stat_info_base;
     CHttpClient *m_http_client;
@@ -144,8 +169,14 @@ protected:
     int m_record_hls_segment_duration;
     float m_record_hls_target_duration;
 
+    int attach_stream();
+    void set_armed(bool armed);
+    void park();
+    void wait_stream();
+    void unwait_stream();
     int handler_write_data();
     int handler_read_data(int64_t *last_read_time = NULL);
+    int handler_standby_data();
     void record_data2hls(char *data, int len);
     void check_hls_file();
     void close_hls_file();
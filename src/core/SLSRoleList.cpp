@@ -36,53 +36,451 @@
 
 CSLSRoleList::CSLSRoleList()
 {
+    m_spread_viewers = 0;
+    m_ingest_count = 0;
+    m_worker_connections = 0;
+    set_worker_count(1);
 }
 CSLSRoleList::~CSLSRoleList()
 {
+    clear_workers();
+}
+
+//only called before any role is pushed.
+void CSLSRoleList::set_worker_count(int count)
+{
+    clear_workers();
+    if (count < 1)
+        count = 1;
+    for (int i = 0; i < count; i++)
+    {
+        SLSWorkerRoles *worker = new SLSWorkerRoles;
+        worker->wake_queue = NULL;
+        worker->role_count = 0;
+        worker->load = 0;
+        worker->bytes = 0;
+        worker->loop_time = 0;
+        worker->max_loop_time = 0;
+        worker->migrate_to = -1;
+        worker->migrate_bytes = 0;
+        worker->migrated = 0;
+        worker->overloaded = false;
+        worker->refused = 0;
+        worker->shed = 0;
+        worker->cpu = -1;
+        worker->node = -1;
+        m_workers.push_back(worker);
+    }
+}
+
+void CSLSRoleList::set_spread_viewers(int viewers)
+{
+    m_spread_viewers = viewers;
+}
+
+//only called before any role is pushed, the rest of the workers is the egress pool.
+void CSLSRoleList::set_ingest_count(int count)
+{
+    m_ingest_count = (count > 0 && count < (int)m_workers.size()) ? count : 0;
+}
+
+int CSLSRoleList::get_pool(int worker)
+{
+    if (m_ingest_count <= 0)
+        return SLS_POOL_SHARED;
+    return worker < m_ingest_count ? SLS_POOL_INGEST : SLS_POOL_EGRESS;
+}
+
+void CSLSRoleList::get_pool_range(int pool, int &first, int &count)
+{
+    first = 0;
+    count = m_workers.size();
+    if (SLS_POOL_INGEST == pool)
+    {
+        count = m_ingest_count;
+    }
+    else if (SLS_POOL_EGRESS == pool)
+    {
+        first = m_ingest_count;
+        count -= m_ingest_count;
+    }
+}
+
+const char *CSLSRoleList::get_pool_name(int pool)
+{
+    if (SLS_POOL_INGEST == pool)
+        return "ingest";
+    if (SLS_POOL_EGRESS == pool)
+        return "egress";
+    return "shared";
+}
+
+void CSLSRoleList::clear_workers()
+{
+    for (SLSWorkerRoles *worker : m_workers)
+    {
+        delete worker;
+    }
+    m_workers.clear();
 }
 
 int CSLSRoleList::push(CSLSRole *role)
 {
     if (role)
     {
-        CSLSLock lock(&m_mutex);
-        m_list_role.push_back(role);
+        push(role, place(role));
+    }
+    return 0;
+}
+
+//put the role on the given worker, e.g. moved by the rebalancer.
+int CSLSRoleList::push(CSLSRole *role, int index)
+{
+    if (role && index >= 0 && index < (int)m_workers.size())
+    {
+        SLSWorkerRoles *worker = m_workers[index];
+        CSLSLock lock(&worker->mutex);
+        worker->roles.push_back(role);
+        if (worker->wake_queue)
+        {
+            worker->wake_queue->wake();
+        }
+        spdlog::trace("[{}] CSLSRoleList::push, {}={}, key='{}', worker={:d}.",
+                      fmt::ptr(this), role->get_role_name(), fmt::ptr(role), role->get_map_data_key(), index);
     }
     return 0;
 }
 
-CSLSRole *CSLSRoleList::pop()
+CSLSRole *CSLSRoleList::pop(int worker)
 {
-    CSLSLock lock(&m_mutex);
+    if (worker < 0 || worker >= (int)m_workers.size())
+        return NULL;
+    SLSWorkerRoles *w = m_workers[worker];
+    CSLSLock lock(&w->mutex);
     CSLSRole *role = NULL;
-    if (!m_list_role.empty())
+    if (!w->roles.empty())
     {
-        role = m_list_role.front();
-        m_list_role.pop_front();
+        role = w->roles.front();
+        w->roles.pop_front();
     }
     return role;
 }
 
+//the home worker of the stream key in the pool of the role,
+//unless the role has no key, the stream is crowded or the worker is full.
+int CSLSRoleList::place(CSLSRole *role)
+{
+    int pool = SLS_POOL_SHARED;
+    if (m_ingest_count > 0)
+    {
+        pool = role->is_write() ? SLS_POOL_EGRESS : SLS_POOL_INGEST;
+    }
+    int first, count;
+    get_pool_range(pool, first, count);
+    if (count == 1)
+        return first;
+
+    const char *key = role->get_map_data_key();
+    size_t len = strlen(key);
+    if (len == 0)
+        return get_least_loaded(first, count);
+    if (role->is_write() && m_spread_viewers > 0 && role->get_stream_viewers() >= m_spread_viewers)
+        return get_least_loaded(first, count);
+    int worker = get_stream_worker(pool, first, count, key);
+    //a full worker doesn't pop, the role would wait in its queue outside any epoll.
+    if (!has_room(worker, 1))
+        return get_least_loaded(first, count);
+    return worker;
+}
+
+void CSLSRoleList::set_worker_connections(int connections)
+{
+    m_worker_connections = connections;
+}
+
+//the worker can take count more roles, the queued ones included.
+bool CSLSRoleList::has_room(int worker, int count)
+{
+    if (worker < 0 || worker >= (int)m_workers.size())
+        return false;
+    if (m_worker_connections <= 0)
+        return true;
+    return get_role_count(worker) + get_queued_count(worker) + count <= m_worker_connections;
+}
+
+//the home worker of the stream key in the pool.
+int CSLSRoleList::get_stream_worker(int pool, int first, int count, const char *key)
+{
+    {
+        CSLSLock lock(&m_mutex_home);
+        std::map<std::pair<int, std::string>, int>::iterator it = m_map_home.find(std::make_pair(pool, std::string(key)));
+        if (it != m_map_home.end())
+            return it->second;
+    }
+    return first + sls_hash_key(key, strlen(key)) % count;
+}
+
+//the stream is moved, its new roles of the pool follow it.
+void CSLSRoleList::set_home(const char *key, int worker)
+{
+    int pool = get_pool(worker);
+    int first, count;
+    get_pool_range(pool, first, count);
+    size_t len = strlen(key);
+    std::pair<int, std::string> home_key(pool, key);
+    CSLSLock lock(&m_mutex_home);
+    if ((int)(first + sls_hash_key(key, len) % count) == worker)
+        m_map_home.erase(home_key);
+    else
+        m_map_home[home_key] = worker;
+}
+
+//the worker with the fewest roles, it has room if any worker of the range has.
+int CSLSRoleList::get_least_loaded(int first, int count)
+{
+    int index = first;
+    int min_load = -1;
+    for (int i = first; i < first + count; i++)
+    {
+        int load = get_role_count(i) + get_queued_count(i);
+        if (min_load < 0 || load < min_load)
+        {
+            min_load = load;
+            index = i;
+        }
+    }
+    return index;
+}
+
 void CSLSRoleList::erase()
 {
-    CSLSLock lock(&m_mutex);
-    spdlog::trace("[{}] CSLSRoleList::erase, list.count={:d}", fmt::ptr(this), m_list_role.size());
-    std::list<CSLSRole *>::iterator it_erase;
-    for (std::list<CSLSRole *>::iterator it = m_list_role.begin(); it != m_list_role.end();)
+    spdlog::trace("[{}] CSLSRoleList::erase, list.count={:d}", fmt::ptr(this), size());
+    for (SLSWorkerRoles *worker : m_workers)
     {
-        CSLSRole *role = *it;
-        if (role)
+        CSLSLock lock(&worker->mutex);
+        for (CSLSRole *role : worker->roles)
         {
-            role->uninit();
-            delete role;
+            if (role)
+            {
+                role->uninit();
+                delete role;
+            }
         }
-        it++;
+        worker->roles.clear();
     }
-    m_list_role.clear();
 }
 
 int CSLSRoleList::size()
 {
-    CSLSLock lock(&m_mutex);
-    return m_list_role.size();
+    int size = 0;
+    for (int i = 0; i < (int)m_workers.size(); i++)
+    {
+        size += get_queued_count(i);
+    }
+    return size;
+}
+
+void CSLSRoleList::add_wake_queue(int worker, CSLSReadyQueue *queue)
+{
+    if (worker < 0 || worker >= (int)m_workers.size())
+        return;
+    CSLSLock lock(&m_workers[worker]->mutex);
+    m_workers[worker]->wake_queue = queue;
+}
+
+void CSLSRoleList::remove_wake_queue(int worker)
+{
+    add_wake_queue(worker, NULL);
+}
+
+int CSLSRoleList::get_worker_count()
+{
+    return m_workers.size();
+}
+
+void CSLSRoleList::set_role_count(int worker, int count)
+{
+    if (worker < 0 || worker >= (int)m_workers.size())
+        return;
+    m_workers[worker]->role_count.store(count, std::memory_order_relaxed);
+}
+
+int CSLSRoleList::get_role_count(int worker)
+{
+    if (worker < 0 || worker >= (int)m_workers.size())
+        return 0;
+    return m_workers[worker]->role_count.load(std::memory_order_relaxed);
+}
+
+//updated by the worker once per load interval.
+void CSLSRoleList::set_load(int worker, int load, int64_t bytes)
+{
+    if (worker < 0 || worker >= (int)m_workers.size())
+        return;
+    m_workers[worker]->load.store(load, std::memory_order_relaxed);
+    m_workers[worker]->bytes.store(bytes, std::memory_order_relaxed);
+}
+
+int CSLSRoleList::get_load(int worker)
+{
+    if (worker < 0 || worker >= (int)m_workers.size())
+        return 0;
+    return m_workers[worker]->load.load(std::memory_order_relaxed);
+}
+
+int64_t CSLSRoleList::get_bytes(int worker)
+{
+    if (worker < 0 || worker >= (int)m_workers.size())
+        return 0;
+    return m_workers[worker]->bytes.load(std::memory_order_relaxed);
+}
+
+void CSLSRoleList::set_loop_time(int worker, int loop_time, int max_loop_time)
+{
+    if (worker < 0 || worker >= (int)m_workers.size())
+        return;
+    m_workers[worker]->loop_time.store(loop_time, std::memory_order_relaxed);
+    m_workers[worker]->max_loop_time.store(max_loop_time, std::memory_order_relaxed);
+}
+
+int CSLSRoleList::get_loop_time(int worker)
+{
+    if (worker < 0 || worker >= (int)m_workers.size())
+        return 0;
+    return m_workers[worker]->loop_time.load(std::memory_order_relaxed);
+}
+
+int CSLSRoleList::get_max_loop_time(int worker)
+{
+    if (worker < 0 || worker >= (int)m_workers.size())
+        return 0;
+    return m_workers[worker]->max_loop_time.load(std::memory_order_relaxed);
+}
+
+int64_t CSLSRoleList::get_migrated(int worker)
+{
+    if (worker < 0 || worker >= (int)m_workers.size())
+        return 0;
+    return m_workers[worker]->migrated.load(std::memory_order_relaxed);
+}
+
+//ask the worker to move about bytes per second of streams to the target.
+int CSLSRoleList::request_migration(int worker, int target, int64_t bytes)
+{
+    if (worker < 0 || worker >= (int)m_workers.size() || target < 0 || target >= (int)m_workers.size())
+        return SLS_ERROR;
+    m_workers[worker]->migrate_bytes.store(bytes, std::memory_order_relaxed);
+    m_workers[worker]->migrate_to.store(target, std::memory_order_release);
+    if (m_workers[worker]->wake_queue)
+    {
+        m_workers[worker]->wake_queue->wake();
+    }
+    return SLS_OK;
+}
+
+//only called by the worker itself.
+bool CSLSRoleList::take_migration(int worker, int &target, int64_t &bytes)
+{
+    if (worker < 0 || worker >= (int)m_workers.size())
+        return false;
+    target = m_workers[worker]->migrate_to.exchange(-1, std::memory_order_acquire);
+    if (target < 0)
+        return false;
+    bytes = m_workers[worker]->migrate_bytes.load(std::memory_order_relaxed);
+    return true;
+}
+
+void CSLSRoleList::add_migrated(int worker)
+{
+    if (worker < 0 || worker >= (int)m_workers.size())
+        return;
+    m_workers[worker]->migrated.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CSLSRoleList::set_overloaded(int worker, bool overloaded)
+{
+    if (worker < 0 || worker >= (int)m_workers.size())
+        return;
+    m_workers[worker]->overloaded.store(overloaded, std::memory_order_relaxed);
+}
+
+bool CSLSRoleList::is_overloaded(int worker)
+{
+    if (worker < 0 || worker >= (int)m_workers.size())
+        return false;
+    return m_workers[worker]->overloaded.load(std::memory_order_relaxed);
+}
+
+//called at the handshake of a new player of the stream key, before the role exists,
+//return true and count it as refused when the worker it would be placed on is overloaded.
+bool CSLSRoleList::check_overload(const char *key)
+{
+    int pool = m_ingest_count > 0 ? SLS_POOL_EGRESS : SLS_POOL_SHARED;
+    int first, count;
+    get_pool_range(pool, first, count);
+    //no lookup of the stream while no worker is overloaded
+    bool overloaded = false;
+    for (int i = first; i < first + count && !overloaded; i++)
+    {
+        overloaded = is_overloaded(i);
+    }
+    if (!overloaded)
+        return false;
+
+    int worker = get_stream_worker(pool, first, count, key);
+    if (!is_overloaded(worker))
+        return false;
+    m_workers[worker]->refused.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void CSLSRoleList::add_shed(int worker, int count)
+{
+    if (worker < 0 || worker >= (int)m_workers.size())
+        return;
+    m_workers[worker]->shed.fetch_add(count, std::memory_order_relaxed);
+}
+
+int64_t CSLSRoleList::get_refused(int worker)
+{
+    if (worker < 0 || worker >= (int)m_workers.size())
+        return 0;
+    return m_workers[worker]->refused.load(std::memory_order_relaxed);
+}
+
+int64_t CSLSRoleList::get_shed(int worker)
+{
+    if (worker < 0 || worker >= (int)m_workers.size())
+        return 0;
+    return m_workers[worker]->shed.load(std::memory_order_relaxed);
+}
+
+void CSLSRoleList::set_placement(int worker, int cpu, int node)
+{
+    if (worker < 0 || worker >= (int)m_workers.size())
+        return;
+    m_workers[worker]->cpu.store(cpu, std::memory_order_relaxed);
+    m_workers[worker]->node.store(node, std::memory_order_relaxed);
+}
+
+int CSLSRoleList::get_cpu(int worker)
+{
+    if (worker < 0 || worker >= (int)m_workers.size())
+        return -1;
+    return m_workers[worker]->cpu.load(std::memory_order_relaxed);
+}
+
+int CSLSRoleList::get_node(int worker)
+{
+    if (worker < 0 || worker >= (int)m_workers.size())
+        return -1;
+    return m_workers[worker]->node.load(std::memory_order_relaxed);
+}
+
+int CSLSRoleList::get_queued_count(int worker)
+{
+    if (worker < 0 || worker >= (int)m_workers.size())
+        return 0;
+    CSLSLock lock(&m_workers[worker]->mutex);
+    return m_workers[worker]->roles.size();
 }
@@ -24,13 +24,56 @@
 
 #pragma once
 
+#include <atomic>
 #include <list>
+#include <map>
+#include <string>
+#include <vector>
 
 #include "SLSRole.hpp"
 #include "SLSLock.hpp"
+#include "SLSReadyQueue.hpp"
+
+enum SLSWorkerPool
+{
+    SLS_POOL_SHARED = 0, //all roles
+    SLS_POOL_INGEST,     //publishers, pullers and listeners
+    SLS_POOL_EGRESS,     //players and pushers
+};
+
+/**
+ * SLSWorkerRoles, the new roles placed on one worker.
+ */
+struct SLSWorkerRoles
+{
+    std::list<CSLSRole *> roles;
+    CSLSMutex mutex;
+    CSLSReadyQueue *wake_queue; //woken when a role is pushed
+    std::atomic<int> role_count; //roles of the worker, updated by the worker
+    std::atomic<int> load;       //permille of the loop time spent working
+    std::atomic<int64_t> bytes;  //bytes moved per second
+    std::atomic<int> loop_time;     //us, average work of one loop, an event waits for it at most
+    std::atomic<int> max_loop_time; //us
+    std::atomic<int> migrate_to; //the worker which a stream is moved to, -1: none
+    std::atomic<int64_t> migrate_bytes; //the bytes per second to move
+    std::atomic<int64_t> migrated;      //streams moved out
+    std::atomic<bool> overloaded; //new players of the worker are refused
+    std::atomic<int64_t> refused; //players refused at the handshake
+    std::atomic<int64_t> shed;    //players closed to relieve the worker
+    std::atomic<int> cpu;        //the cpu which the worker last ran on
+    std::atomic<int> node;       //numa node of the pinned cpus, -1: not pinned
+};
 
 /**
  * CSLSRoleList
+ * new roles waiting for a worker, each worker pops from its own queue.
+ * a role is placed on the home worker of its stream key, so a publisher
+ * and its players share a worker, roles without a stream key and the
+ * players of a crowded stream go to the least loaded worker.
+ * a stream moved by the rebalancer keeps its new worker as its home.
+ * with an ingest pool, the readers and the writers of a stream are placed
+ * in their own pool, they only share the stream ring.
+ * a new player is refused while the worker of its stream is overloaded.
  */
 class CSLSRoleList
 {
@@ -38,14 +81,61 @@ public:
     CSLSRoleList();
     ~CSLSRoleList();
 
+    void set_worker_count(int count);
+    void set_spread_viewers(int viewers);
+    void set_ingest_count(int count);
+    void set_worker_connections(int connections);
+    bool has_room(int worker, int count);
+    int get_pool(int worker);
+    void get_pool_range(int pool, int &first, int &count);
+    static const char *get_pool_name(int pool);
+
     int push(CSLSRole *role);
-    CSLSRole *pop();
+    int push(CSLSRole *role, int worker);
+    CSLSRole *pop(int worker);
     void erase();
     int size();
 
+    void add_wake_queue(int worker, CSLSReadyQueue *queue);
+    void remove_wake_queue(int worker);
+
+    int get_worker_count();
+    void set_role_count(int worker, int count);
+    int get_role_count(int worker);
+    int get_queued_count(int worker);
+
+    void set_load(int worker, int load, int64_t bytes);
+    int get_load(int worker);
+    int64_t get_bytes(int worker);
+    void set_loop_time(int worker, int loop_time, int max_loop_time);
+    int get_loop_time(int worker);
+    int get_max_loop_time(int worker);
+    int64_t get_migrated(int worker);
+    int request_migration(int worker, int target, int64_t bytes);
+    bool take_migration(int worker, int &target, int64_t &bytes);
+    void add_migrated(int worker);
+    void set_home(const char *key, int worker);
+    void set_overloaded(int worker, bool overloaded);
+    bool is_overloaded(int worker);
+    bool check_overload(const char *key);
+    void add_shed(int worker, int count);
+    int64_t get_refused(int worker);
+    int64_t get_shed(int worker);
+    void set_placement(int worker, int cpu, int node);
+    int get_cpu(int worker);
+    int get_node(int worker);
+
 protected:
 private:
-    std::list<CSLSRole *> m_list_role;
+    std::vector<SLSWorkerRoles *> m_workers;
+    int m_spread_viewers; //players of a stream beyond it are spread, 0: never
+    int m_ingest_count;   //the first workers, 0: no ingest pool
+    int m_worker_connections; //roles of a worker, 0: unlimited
+    std::map<std::pair<int, std::string>, int> m_map_home; //streams of a pool moved away from their hash worker
+    CSLSMutex m_mutex_home;
 
-    CSLSMutex m_mutex;
+    int place(CSLSRole *role);
+    int get_stream_worker(int pool, int first, int count, const char *key);
+    int get_least_loaded(int first, int count);
+    void clear_workers();
 };
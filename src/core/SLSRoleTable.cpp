@@ -0,0 +1,186 @@
+
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Edward.Wu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <srt/srt.h>
+
+#include "SLSRoleTable.hpp"
+
+/**
+ * CSLSRoleTable class implementation
+ */
+
+#define ROLE_TABLE_MIN_SLOTS 64
+
+CSLSRoleTable::CSLSRoleTable()
+{
+    m_slots.resize(ROLE_TABLE_MIN_SLOTS);
+    m_mask = ROLE_TABLE_MIN_SLOTS - 1;
+}
+
+CSLSRoleTable::~CSLSRoleTable()
+{
+}
+
+//the slot of the fd, or the empty slot where it would be.
+unsigned int CSLSRoleTable::get_slot(int fd)
+{
+    //srt sockets are allocated in sequence, spread them over the slots.
+    unsigned int i = ((unsigned int)fd * 2654435761u) & m_mask;
+    while (m_slots[i].fd != 0 && m_slots[i].fd != fd)
+    {
+        i = (i + 1) & m_mask;
+    }
+    return i;
+}
+
+void CSLSRoleTable::grow()
+{
+    std::vector<SLSRoleSlot> slots(m_slots.size() * 2);
+    m_slots.swap(slots);
+    m_mask = m_slots.size() - 1;
+    for (int i = 0; i < (int)m_entries.size(); i++)
+    {
+        SLSRoleSlot &slot = m_slots[get_slot(m_entries[i].fd)];
+        slot.fd = m_entries[i].fd;
+        slot.index = i;
+    }
+}
+
+bool CSLSRoleTable::insert(int fd, CSLSRole *role)
+{
+    if (fd == 0)
+        return false;
+    if ((m_entries.size() + 1) * 2 > m_slots.size())
+    {
+        grow();
+    }
+    SLSRoleSlot &slot = m_slots[get_slot(fd)];
+    if (slot.fd == fd)
+    {
+        m_entries[slot.index].role = role;
+        return false;
+    }
+    slot.fd = fd;
+    slot.index = m_entries.size();
+    SLSRoleEntry entry = {fd, role, 0, 0};
+    m_entries.push_back(entry);
+    return true;
+}
+
+CSLSRole *CSLSRoleTable::find(int fd)
+{
+    int index = find_index(fd);
+    return index < 0 ? NULL : m_entries[index].role;
+}
+
+int CSLSRoleTable::find_index(int fd)
+{
+    if (fd == 0)
+        return -1;
+    SLSRoleSlot &slot = m_slots[get_slot(fd)];
+    return slot.fd == fd ? slot.index : -1;
+}
+
+bool CSLSRoleTable::erase(int fd)
+{
+    if (fd == 0)
+        return false;
+    unsigned int i = get_slot(fd);
+    if (m_slots[i].fd != fd)
+        return false;
+
+    //move the last entry into the hole.
+    int index = m_slots[i].index;
+    int last = m_entries.size() - 1;
+    if (index != last)
+    {
+        m_entries[index] = m_entries[last];
+        m_slots[get_slot(m_entries[index].fd)].index = index;
+    }
+    m_entries.pop_back();
+
+    //shift back the following slots of the probe sequence.
+    unsigned int hole = i;
+    unsigned int j = i;
+    while (true)
+    {
+        j = (j + 1) & m_mask;
+        if (m_slots[j].fd == 0)
+            break;
+        unsigned int home = ((unsigned int)m_slots[j].fd * 2654435761u) & m_mask;
+        //keep the slot if its home lies cyclically in (hole, j].
+        if ((hole < j) ? (home > hole && home <= j) : (home > hole || home <= j))
+            continue;
+        m_slots[hole] = m_slots[j];
+        hole = j;
+    }
+    m_slots[hole].fd = 0;
+    m_slots[hole].index = 0;
+    return true;
+}
+
+void CSLSRoleTable::clear()
+{
+    m_entries.clear();
+    m_slots.assign(ROLE_TABLE_MIN_SLOTS, SLSRoleSlot());
+    m_mask = ROLE_TABLE_MIN_SLOTS - 1;
+}
+
+int CSLSRoleTable::size()
+{
+    return m_entries.size();
+}
+
+SLSRoleEntry &CSLSRoleTable::at(int index)
+{
+    return m_entries[index];
+}
+
+//combine the events of each role of a poll into its entry, a broken socket is
+//reported in both lists. event_roles gets the index of each role with events once,
+//return the count of the sockets which have no role.
+int CSLSRoleTable::merge_events(const int *write_socks, int write_len, const int *read_socks, int read_len,
+                                std::vector<int> &event_roles)
+{
+    int unknown = 0;
+    event_roles.clear();
+    for (int i = 0; i < write_len + read_len; i++)
+    {
+        bool write = i < write_len;
+        int index = find_index(write ? write_socks[i] : read_socks[i - write_len]);
+        if (index < 0)
+        {
+            unknown++;
+            continue;
+        }
+        SLSRoleEntry &entry = m_entries[index];
+        if (0 == entry.events)
+        {
+            event_roles.push_back(index);
+        }
+        entry.events |= write ? SRT_EPOLL_OUT : SRT_EPOLL_IN;
+    }
+    return unknown;
+}
@@ -0,0 +1,80 @@
+
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Edward.Wu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+class CSLSRole;
+
+/**
+ * SLSRoleEntry, a role of the worker with the events of the current poll.
+ */
+struct SLSRoleEntry
+{
+    int fd;
+    CSLSRole *role;
+    int events; //SRT_EPOLL_IN | SRT_EPOLL_OUT reported for the role, 0 once dispatched
+    int64_t check_tm; //ms, due time of the current housekeeping timer of the role
+};
+
+/**
+ * CSLSRoleTable
+ * the roles of a worker in a dense array, found by their socket through an
+ * open addressing index, so the poll loop needs no tree walk per event.
+ * erase moves the last role into the hole, walk the roles backwards to
+ * erase while walking.
+ */
+class CSLSRoleTable
+{
+public:
+    CSLSRoleTable();
+    ~CSLSRoleTable();
+
+    bool insert(int fd, CSLSRole *role);
+    CSLSRole *find(int fd);
+    int find_index(int fd);
+    bool erase(int fd);
+    void clear();
+
+    int size();
+    SLSRoleEntry &at(int index);
+
+    int merge_events(const int *write_socks, int write_len, const int *read_socks, int read_len,
+                     std::vector<int> &event_roles);
+
+private:
+    struct SLSRoleSlot
+    {
+        int fd;    //0: empty, srt sockets are never 0
+        int index; //into m_entries
+    };
+    std::vector<SLSRoleEntry> m_entries;
+    std::vector<SLSRoleSlot> m_slots; //power of two, at most half full
+    unsigned int m_mask;
+
+    unsigned int get_slot(int fd);
+    void grow();
+};
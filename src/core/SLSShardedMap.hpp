@@ -0,0 +1,162 @@
+
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Edward.Wu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <map>
+#include <unordered_map>
+
+#include "SLSLock.hpp"
+
+const int SLS_SHARD_COUNT = 64; //shards of a registry, each with its own lock
+
+/**
+ * CSLSShardedMap
+ * hash map split into SLS_SHARD_COUNT shards by the key hash, every operation
+ * only locks the shard of its key, so there is no global writer lock.
+ */
+template <typename K, typename V>
+class CSLSShardedMap
+{
+public:
+    //insert the value if the key is absent, else return false and the current value.
+    bool insert(const K &key, const V &value, V *cur_value = NULL)
+    {
+        Shard &shard = get_shard(key);
+        CSLSLock lock(&shard.rwclock, true);
+        std::pair<typename std::unordered_map<K, V>::iterator, bool> ret = shard.map.insert(std::make_pair(key, value));
+        if (!ret.second && cur_value)
+            *cur_value = ret.first->second;
+        return ret.second;
+    }
+
+    void set(const K &key, const V &value)
+    {
+        Shard &shard = get_shard(key);
+        CSLSLock lock(&shard.rwclock, true);
+        shard.map[key] = value;
+    }
+
+    bool find(const K &key, V &value)
+    {
+        Shard &shard = get_shard(key);
+        CSLSLock lock(&shard.rwclock, false);
+        typename std::unordered_map<K, V>::iterator it = shard.map.find(key);
+        if (it == shard.map.end())
+            return false;
+        value = it->second;
+        return true;
+    }
+
+    //call f(value) with the shard locked for read, the value can't be erased meanwhile.
+    bool visit(const K &key, const std::function<void(V &)> &f)
+    {
+        Shard &shard = get_shard(key);
+        CSLSLock lock(&shard.rwclock, false);
+        typename std::unordered_map<K, V>::iterator it = shard.map.find(key);
+        if (it == shard.map.end())
+            return false;
+        f(it->second);
+        return true;
+    }
+
+    bool erase(const K &key, V *value = NULL)
+    {
+        Shard &shard = get_shard(key);
+        CSLSLock lock(&shard.rwclock, true);
+        typename std::unordered_map<K, V>::iterator it = shard.map.find(key);
+        if (it == shard.map.end())
+            return false;
+        if (value)
+            *value = it->second;
+        shard.map.erase(it);
+        return true;
+    }
+
+    //erase the key only if it still maps to value.
+    bool erase_if(const K &key, const V &value)
+    {
+        Shard &shard = get_shard(key);
+        CSLSLock lock(&shard.rwclock, true);
+        typename std::unordered_map<K, V>::iterator it = shard.map.find(key);
+        if (it == shard.map.end() || !(it->second == value))
+            return false;
+        shard.map.erase(it);
+        return true;
+    }
+
+    //walk all the items, one shard is locked at a time.
+    void for_each(const std::function<void(const K &, V &)> &f)
+    {
+        for (int i = 0; i < SLS_SHARD_COUNT; i++)
+        {
+            CSLSLock lock(&m_shards[i].rwclock, false);
+            for (typename std::unordered_map<K, V>::iterator it = m_shards[i].map.begin(); it != m_shards[i].map.end(); it++)
+            {
+                f(it->first, it->second);
+            }
+        }
+    }
+
+    //move all the items out, the caller releases them.
+    void clear(std::map<K, V> *items = NULL)
+    {
+        for (int i = 0; i < SLS_SHARD_COUNT; i++)
+        {
+            CSLSLock lock(&m_shards[i].rwclock, true);
+            if (items)
+                items->insert(m_shards[i].map.begin(), m_shards[i].map.end());
+            m_shards[i].map.clear();
+        }
+    }
+
+    size_t size()
+    {
+        size_t n = 0;
+        for (int i = 0; i < SLS_SHARD_COUNT; i++)
+        {
+            CSLSLock lock(&m_shards[i].rwclock, false);
+            n += m_shards[i].map.size();
+        }
+        return n;
+    }
+
+private:
+    struct Shard
+    {
+        CSLSRWLock rwclock;
+        std::unordered_map<K, V> map;
+    };
+    Shard m_shards[SLS_SHARD_COUNT];
+
+    Shard &get_shard(const K &key)
+    {
+        //mix the bits, the low bits of a pointer hash are always zero.
+        uint64_t h = std::hash<K>()(key);
+        h = (h ^ (h >> 29)) * 0x9E3779B97F4A7C15ULL;
+        return m_shards[(h >> 32) % SLS_SHARD_COUNT];
+    }
+};
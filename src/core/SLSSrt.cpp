@@ -158,6 +158,11 @@ void CSLSSrt::libsrt_set_latency(int latency)
     m_sc.latency = latency;
 }
 
+void CSLSSrt::libsrt_set_payload_size(int payload_size)
+{
+    m_sc.payload_size = payload_size;
+}
+
 int CSLSSrt::libsrt_setup(int port)
 {
     struct addrinfo hints = {0}, *ai;
@@ -236,6 +241,12 @@ int CSLSSrt::libsrt_setup(int port)
     {
         srt_setsockopt(fd, SOL_SOCKET, SRTO_LATENCY, &s->latency, sizeof(s->latency));
     }
+    //accepted sockets inherit it, players can get messages up to this size.
+    if (s->payload_size > 0)
+    {
+        if (srt_setsockopt(fd, SOL_SOCKET, SRTO_PAYLOADSIZE, &s->payload_size, sizeof(s->payload_size)))
+            spdlog::warn("[{}] CSLSSrt::libsrt_setup, setsockopt(SRTO_PAYLOADSIZE) failed, payload_size={:d}.", fmt::ptr(this), s->payload_size);
+    }
     if (s->recv_buffer_size > 0)
     {
         srt_setsockopt(fd, SOL_SOCKET, SRTO_UDP_RCVBUF, &s->recv_buffer_size, sizeof(s->recv_buffer_size));
@@ -277,8 +288,8 @@ int CSLSSrt::libsrt_listen(int backlog)
     return SLS_OK;
 }
 
-int CSLSSrt::libsrt_set_listen_callback(srt_listen_callback_fn * listen_callback_fn) {
-    int ret = srt_listen_callback(m_sc.fd, listen_callback_fn, NULL);
+int CSLSSrt::libsrt_set_listen_callback(srt_listen_callback_fn * listen_callback_fn, void *opaque) {
+    int ret = srt_listen_callback(m_sc.fd, listen_callback_fn, opaque);
     if (ret) {
         return SLS_ERROR;
     }
@@ -405,6 +416,11 @@ int CSLSSrt::libsrt_read(char *buf, int size)
     ret = srt_recvmsg(m_sc.fd, buf, size);
     if (ret < 0)
     {
+        if (srt_getlasterror(NULL) == SRT_EASYNCRCV)
+        {
+            //non blocking socket is drained
+            return SLSERROR(EAGAIN);
+        }
         int err_no = libsrt_neterrno();
         spdlog::warn("[{}] CSLSSrt::libsrt_read failed, sock={:d}, ret={:d}, err_no={:d}.",
                      fmt::ptr(this), m_sc.fd, ret, err_no);
@@ -425,11 +441,12 @@ int CSLSSrt::libsrt_write(const char *buf, int size)
     return ret;
 }
 
-int CSLSSrt::libsrt_add_to_epoll(int eid, bool write)
+//a socket which isn't armed only reports errors.
+int CSLSSrt::libsrt_add_to_epoll(int eid, bool write, bool armed)
 {
     int ret = SLS_OK;
     int fd = m_sc.fd;
-    int modes = write ? SRT_EPOLL_OUT : SRT_EPOLL_IN;
+    int modes = armed ? (write ? SRT_EPOLL_OUT : SRT_EPOLL_IN) : 0;
 
     if (!eid)
     {
@@ -448,6 +465,30 @@ int CSLSSrt::libsrt_add_to_epoll(int eid, bool write)
     return ret;
 }
 
+int CSLSSrt::libsrt_update_epoll(bool write, bool armed)
+{
+    int ret = SLS_OK;
+    int fd = m_sc.fd;
+    int eid = m_sc.eid;
+    int modes = armed ? (write ? SRT_EPOLL_OUT : SRT_EPOLL_IN) : 0;
+
+    if (!eid)
+    {
+        spdlog::error("[{}] CSLSSrt::libsrt_update_epoll failed, m_eid={:d}.", fmt::ptr(this), eid);
+        return SLS_ERROR;
+    }
+
+    modes |= SRT_EPOLL_ERR;
+    ret = srt_epoll_update_usock(eid, fd, &modes);
+    if (ret < 0)
+    {
+        spdlog::error("[{}] CSLSSrt::libsrt_update_epoll, srt_epoll_update_usock failed, m_eid={:d}, fd={:d}, modes={:d}.",
+                      fmt::ptr(this), eid, fd, modes);
+        return libsrt_neterrno();
+    }
+    return ret;
+}
+
 int CSLSSrt::libsrt_remove_from_epoll()
 {
     int ret = SLS_OK;
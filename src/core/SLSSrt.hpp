@@ -98,7 +98,7 @@ public:
     int libsrt_close();
 
     int libsrt_listen(int backlog);
-    int libsrt_set_listen_callback(srt_listen_callback_fn * listen_callback_fn);
+    int libsrt_set_listen_callback(srt_listen_callback_fn * listen_callback_fn, void *opaque = NULL);
     int libsrt_accept();
 
     int libsrt_get_fd();
@@ -116,7 +116,8 @@ public:
 
     std::map<std::string, std::string>  libsrt_parse_sid(char *sid);
 
-    int libsrt_add_to_epoll(int eid, bool write);
+    int libsrt_add_to_epoll(int eid, bool write, bool armed = true);
+    int libsrt_update_epoll(bool write, bool armed = true);
     int libsrt_remove_from_epoll();
 
     int libsrt_getsockstate();
@@ -125,6 +126,7 @@ public:
     int libsrt_get_statistics(SRT_TRACEBSTATS *currentStats, int clear);
 
     void libsrt_set_latency(int latency);
+    void libsrt_set_payload_size(int payload_size);
 
     static int libsrt_neterrno();
     static void libsrt_print_error_info();
@@ -37,6 +37,7 @@ CSLSThread::CSLSThread()
 {
 	m_exit = 0;
 	m_th_id = 0;
+	m_priority = 0;
 }
 CSLSThread::~CSLSThread()
 {
@@ -81,6 +82,18 @@ void CSLSThread::clear()
 {
 }
 
+//please call this function before start.
+void CSLSThread::set_cpus(const std::vector<int> &cpus)
+{
+	m_cpus = cpus;
+}
+
+//please call this function before start, needs CAP_SYS_NICE.
+void CSLSThread::set_priority(int priority)
+{
+	m_priority = priority;
+}
+
 bool CSLSThread::is_exit()
 {
 	return m_exit == 1;
@@ -94,6 +107,32 @@ void *CSLSThread::thread_func(void *arg)
 		spdlog::error("CSLSThread::thread_func, thread arg is null.");
 	}
 
+	if (!pThis->m_cpus.empty())
+	{
+		cpu_set_t cpu_set;
+		CPU_ZERO(&cpu_set);
+		for (int cpu : pThis->m_cpus)
+		{
+			CPU_SET(cpu, &cpu_set);
+		}
+		int err = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+		if (err != 0)
+		{
+			spdlog::error("[{}] CSLSThread::thread_func, pthread_setaffinity_np failed, error: {}", fmt::ptr(pThis), strerror(err));
+		}
+	}
+
+	if (pThis->m_priority > 0)
+	{
+		struct sched_param param;
+		param.sched_priority = pThis->m_priority;
+		int err = pthread_setschedparam(pthread_self(), SCHED_RR, &param);
+		if (err != 0)
+		{
+			spdlog::error("[{}] CSLSThread::thread_func, pthread_setschedparam failed, priority={:d}, error: {}", fmt::ptr(pThis), pThis->m_priority, strerror(err));
+		}
+	}
+
 	pThis->work();
 	return NULL;
 }
@@ -25,6 +25,7 @@
 #pragma once
 
 #include <pthread.h>
+#include <vector>
 
 /**
  * CSLSThread , the base thread class
@@ -39,12 +40,16 @@ public:
     int stop();
 
     bool is_exit();
+    void set_cpus(const std::vector<int> &cpus);
+    void set_priority(int priority);
 
     virtual int work();
 
 protected:
     bool m_exit;
     pthread_t m_th_id;
+    std::vector<int> m_cpus; //the cpus which the thread runs on, empty: any
+    int m_priority;          //SCHED_RR priority, 0: normal scheduling
 
     virtual void clear();
 
@@ -0,0 +1,673 @@
+
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Edward.Wu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "spdlog/spdlog.h"
+
+#include "SLSTimeShift.hpp"
+#include "SLSLog.hpp"
+
+/**
+ * CSLSTimeShiftSpiller class implementation
+ */
+
+CSLSTimeShiftSpiller *CSLSTimeShiftSpiller::get_instance()
+{
+    static CSLSTimeShiftSpiller spiller;
+    return &spiller;
+}
+
+CSLSTimeShiftSpiller::CSLSTimeShiftSpiller()
+{
+    m_running_owner = NULL;
+    m_started = false;
+    pthread_cond_init(&m_cond, NULL);
+}
+
+CSLSTimeShiftSpiller::~CSLSTimeShiftSpiller()
+{
+    //the thread uses the members, it is stopped before they are gone.
+    stop();
+    for (SLSTimeShiftSpill &job : m_jobs)
+    {
+        for (SLSChunk *chunk : job.chunks)
+        {
+            CSLSRecycleArray::release_chunk(chunk);
+        }
+    }
+    m_jobs.clear();
+    pthread_cond_destroy(&m_cond);
+}
+
+//called by the publishers, the thread is started with the first job.
+void CSLSTimeShiftSpiller::push(SLSTimeShiftSpill &job)
+{
+    CSLSLock lock(&m_mutex);
+    if (!m_started)
+    {
+        m_started = true;
+        start();
+    }
+    m_jobs.push_back(job);
+    pthread_cond_broadcast(&m_cond);
+}
+
+//drop the jobs of the owner, it is never called back once this returns.
+void CSLSTimeShiftSpiller::cancel(CSLSTimeShift *owner)
+{
+    CSLSLock lock(&m_mutex);
+    std::deque<SLSTimeShiftSpill>::iterator it = m_jobs.begin();
+    while (it != m_jobs.end())
+    {
+        if (it->owner != owner)
+        {
+            it++;
+            continue;
+        }
+        for (SLSChunk *chunk : it->chunks)
+        {
+            CSLSRecycleArray::release_chunk(chunk);
+        }
+        it = m_jobs.erase(it);
+    }
+    while (m_running_owner == owner)
+    {
+        pthread_cond_wait(&m_cond, m_mutex.get_mutex());
+    }
+}
+
+int CSLSTimeShiftSpiller::work()
+{
+    spdlog::info("[{}] CSLSTimeShiftSpiller::work, begin.", fmt::ptr(this));
+    while (!is_exit())
+    {
+        SLSTimeShiftSpill job;
+        {
+            CSLSLock lock(&m_mutex);
+            if (m_jobs.empty())
+            {
+                //woken by push, the timeout checks for stop.
+                struct timespec ts;
+                clock_gettime(CLOCK_REALTIME, &ts);
+                ts.tv_nsec += 100 * 1000000;
+                if (ts.tv_nsec >= 1000000000)
+                {
+                    ts.tv_sec++;
+                    ts.tv_nsec -= 1000000000;
+                }
+                pthread_cond_timedwait(&m_cond, m_mutex.get_mutex(), &ts);
+                continue;
+            }
+            job = m_jobs.front();
+            m_jobs.pop_front();
+            m_running_owner = job.owner;
+        }
+
+        bool ok = SLS_OK == spill(job);
+        for (SLSChunk *chunk : job.chunks)
+        {
+            CSLSRecycleArray::release_chunk(chunk);
+        }
+        job.owner->on_spilled(job.segment_id, ok);
+
+        CSLSLock lock(&m_mutex);
+        m_running_owner = NULL;
+        pthread_cond_broadcast(&m_cond);
+    }
+    spdlog::info("[{}] CSLSTimeShiftSpiller::work, end.", fmt::ptr(this));
+    return SLS_OK;
+}
+
+int CSLSTimeShiftSpiller::spill(SLSTimeShiftSpill &job)
+{
+    int fd = ::open(job.filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        spdlog::error("[{}] CSLSTimeShiftSpiller::spill, open '{}' failed, errno={:d}.",
+                      fmt::ptr(this), job.filename, errno);
+        return SLS_ERROR;
+    }
+    for (SLSChunk *chunk : job.chunks)
+    {
+        int len = chunk->len.load(std::memory_order_acquire);
+        if (::write(fd, chunk->data, len) != len)
+        {
+            spdlog::error("[{}] CSLSTimeShiftSpiller::spill, write '{}' failed, errno={:d}.",
+                          fmt::ptr(this), job.filename, errno);
+            ::close(fd);
+            unlink(job.filename.c_str());
+            return SLS_ERROR;
+        }
+    }
+    ::close(fd);
+    return SLS_OK;
+}
+
+/**
+ * CSLSTimeShift class implementation
+ */
+
+CSLSTimeShift::CSLSTimeShift(const char *key, const SLSTimeShiftConf *conf, bool message_mode)
+{
+    m_key = key;
+    m_duration = conf->duration;
+    m_memory = std::min(conf->memory, conf->duration);
+    m_message_mode = message_mode;
+    m_next_id = 0;
+    m_last_check_time = 0;
+    m_spilled_pending = false;
+
+    if (strlen(conf->path) > 0)
+    {
+        //one directory per stream data, a replaced stream of the same key never shares it.
+        std::string name = m_key;
+        std::replace(name.begin(), name.end(), '/', '_');
+        char path[URL_MAX_LEN] = {0};
+        int n = snprintf(path, sizeof(path), "%s/%s-%lld", conf->path, name.c_str(), (long long)sls_gettime_ms());
+        if (n < 0 || n >= (int)sizeof(path))
+        {
+            spdlog::error("[{}] CSLSTimeShift::CSLSTimeShift, key={}, path '{}' is too long, keep the data in memory.",
+                          fmt::ptr(this), m_key, conf->path);
+        }
+        else if (sls_mkdir_p(path) != -1)
+        {
+            m_path = path;
+        }
+        else
+        {
+            spdlog::error("[{}] CSLSTimeShift::CSLSTimeShift, key={}, mkdir '{}' failed, keep the data in memory.",
+                          fmt::ptr(this), m_key, path);
+        }
+    }
+    if (m_path.empty())
+    {
+        m_memory = m_duration;
+    }
+    spdlog::info("[{}] CSLSTimeShift::CSLSTimeShift, key={}, duration={:d}ms, memory={:d}ms, path='{}'.",
+                 fmt::ptr(this), m_key, m_duration, m_memory, m_path);
+}
+
+CSLSTimeShift::~CSLSTimeShift()
+{
+    if (!m_path.empty())
+    {
+        //the files written meanwhile of the dropped segments are removed by check_spilled.
+        CSLSTimeShiftSpiller::get_instance()->cancel(this);
+        check_spilled();
+    }
+    for (SLSTimeShiftSegment *segment : m_segments)
+    {
+        free_segment(segment);
+    }
+    m_segments.clear();
+    if (!m_path.empty())
+    {
+        rmdir(m_path.c_str());
+    }
+}
+
+void CSLSTimeShift::init_id(SLSTimeShiftID *read_id, int64_t shift)
+{
+    read_id->shift = shift;
+    read_id->segment_id = -1;
+    read_id->pos = 0;
+    read_id->overrun = 0;
+    read_id->bFirst = true;
+    read_id->fd = -1;
+    read_id->fd_segment_id = -1;
+}
+
+void CSLSTimeShift::close_id(SLSTimeShiftID *read_id)
+{
+    if (read_id->fd >= 0)
+    {
+        ::close(read_id->fd);
+    }
+    read_id->fd = -1;
+    read_id->fd_segment_id = -1;
+}
+
+//only called by the publisher with the committed data,
+//a new segment starts at a keyframe, the data before the first one is dropped.
+int CSLSTimeShift::write(const char *data, int len, int keyframe_pos, int64_t cur_time_ms)
+{
+    if (len <= 0)
+    {
+        return SLS_OK;
+    }
+    check_spilled();
+
+    //the publisher changes m_segments under the write lock, so it reads it without a lock.
+    SLSTimeShiftSegment *last = m_segments.empty() ? NULL : m_segments.back();
+    if (keyframe_pos >= 0 && (NULL == last || cur_time_ms - last->start_time_ms >= SLS_TIMESHIFT_SEGMENT_DURATION))
+    {
+        if (NULL != last)
+        {
+            append(last, data, keyframe_pos);
+            add_checkpoint(last, cur_time_ms);
+        }
+        data += keyframe_pos;
+        len -= keyframe_pos;
+
+        SLSTimeShiftSegment *segment = new SLSTimeShiftSegment;
+        segment->id = m_next_id++;
+        segment->start_time_ms = cur_time_ms;
+        segment->size = 0;
+        segment->written = 0;
+        segment->spilled = false;
+        segment->spilling = false;
+        {
+            CSLSLock lock(&m_rwclock, true);
+            m_segments.push_back(segment);
+        }
+        last = segment;
+    }
+    if (NULL == last)
+    {
+        return SLS_OK;
+    }
+
+    append(last, data, len);
+    if (last->checkpoints.empty() ||
+        cur_time_ms - last->checkpoints.back().time_ms >= SLS_TIMESHIFT_CHECKPOINT_INTERVAL)
+    {
+        add_checkpoint(last, cur_time_ms);
+    }
+
+    if (cur_time_ms - m_last_check_time >= SLS_TIMESHIFT_SEGMENT_DURATION)
+    {
+        m_last_check_time = cur_time_ms;
+        check_segments(cur_time_ms);
+    }
+    return SLS_OK;
+}
+
+//only called by the publisher, a message is never split across chunks.
+void CSLSTimeShift::append(SLSTimeShiftSegment *segment, const char *data, int len)
+{
+    int pos = 0;
+    while (pos < len)
+    {
+        int n = len - pos;
+        if (m_message_mode)
+        {
+            n = SLS_MSG_HEADER_LEN + sls_get_msg_len(data + pos);
+        }
+        SLSChunk *chunk = segment->chunks.empty() ? NULL : segment->chunks.back();
+        int avail = chunk ? chunk->capacity - chunk->len.load(std::memory_order_relaxed) : 0;
+        if (avail <= 0 || (m_message_mode && avail < n))
+        {
+            chunk = CSLSRecycleArray::alloc_chunk(SLS_CHUNK_SIZE);
+            chunk->seq.store(-1, std::memory_order_relaxed);
+            chunk->ring_id.store(0, std::memory_order_relaxed);
+            chunk->byte_seq.store(segment->written, std::memory_order_relaxed);
+            {
+                CSLSLock lock(&m_rwclock, true);
+                segment->chunks.push_back(chunk);
+            }
+            avail = chunk->capacity;
+        }
+        if (n > avail)
+        {
+            n = avail;
+        }
+        int chunk_len = chunk->len.load(std::memory_order_relaxed);
+        memcpy(chunk->data + chunk_len, data + pos, n);
+        chunk->len.store(chunk_len + n, std::memory_order_release);
+        segment->written += n;
+        pos += n;
+    }
+}
+
+//publish the written data of the segment to the readers.
+void CSLSTimeShift::add_checkpoint(SLSTimeShiftSegment *segment, int64_t cur_time_ms)
+{
+    CSLSLock lock(&m_rwclock, true);
+    segment->size = segment->written;
+    segment->checkpoints.push_back({cur_time_ms, segment->written});
+}
+
+//only called by the publisher, drop the segments out of the duration
+//and spill the closed ones out of the memory tier.
+void CSLSTimeShift::check_segments(int64_t cur_time_ms)
+{
+    //a segment is needed until the next one starts within the duration.
+    while (m_segments.size() > 1 && m_segments[1]->start_time_ms <= cur_time_ms - m_duration)
+    {
+        SLSTimeShiftSegment *segment = m_segments.front();
+        {
+            CSLSLock lock(&m_rwclock, true);
+            m_segments.pop_front();
+        }
+        free_segment(segment);
+    }
+
+    if (m_path.empty())
+    {
+        return;
+    }
+    for (size_t i = 0; i + 1 < m_segments.size(); i++)
+    {
+        SLSTimeShiftSegment *segment = m_segments[i];
+        if (segment->start_time_ms > cur_time_ms - m_memory)
+        {
+            break;
+        }
+        if (!segment->spilled && !segment->spilling)
+        {
+            spill(segment);
+        }
+    }
+}
+
+//queue the closed segment to the spill thread, it is read from memory until it is written.
+void CSLSTimeShift::spill(SLSTimeShiftSegment *segment)
+{
+    char filename[URL_MAX_LEN] = {0};
+    get_filename(segment->id, filename, sizeof(filename));
+    SLSTimeShiftSpill job;
+    job.owner = this;
+    job.segment_id = segment->id;
+    job.filename = filename;
+    job.chunks = segment->chunks;
+    for (SLSChunk *chunk : job.chunks)
+    {
+        CSLSRecycleArray::add_ref_chunk(chunk);
+    }
+    segment->spilling = true;
+    CSLSTimeShiftSpiller::get_instance()->push(job);
+}
+
+//called by the spill thread once the file of the segment is written.
+void CSLSTimeShift::on_spilled(int64_t segment_id, bool ok)
+{
+    CSLSLock lock(&m_spilled_mutex);
+    m_spilled.push_back(std::make_pair(segment_id, ok));
+    m_spilled_pending.store(true, std::memory_order_release);
+}
+
+//only called by the publisher, the written segments are read from their files from now on.
+void CSLSTimeShift::check_spilled()
+{
+    if (!m_spilled_pending.load(std::memory_order_acquire))
+    {
+        return;
+    }
+    std::vector<std::pair<int64_t, bool>> spilled;
+    {
+        CSLSLock lock(&m_spilled_mutex);
+        spilled.swap(m_spilled);
+        m_spilled_pending.store(false, std::memory_order_relaxed);
+    }
+
+    for (std::pair<int64_t, bool> &item : spilled)
+    {
+        int64_t index = m_segments.empty() ? -1 : item.first - m_segments.front()->id;
+        if (index < 0 || index >= (int64_t)m_segments.size())
+        {
+            //the segment was dropped while it was written.
+            if (item.second)
+            {
+                char filename[URL_MAX_LEN] = {0};
+                get_filename(item.first, filename, sizeof(filename));
+                unlink(filename);
+            }
+            continue;
+        }
+        SLSTimeShiftSegment *segment = m_segments[index];
+        segment->spilling = false;
+        if (!item.second)
+        {
+            //kept in memory, the duration still bounds it.
+            continue;
+        }
+
+        //readers still sending from the chunks keep their own references.
+        std::vector<SLSChunk *> chunks;
+        {
+            CSLSLock lock(&m_rwclock, true);
+            chunks.swap(segment->chunks);
+            segment->spilled = true;
+        }
+        for (SLSChunk *chunk : chunks)
+        {
+            CSLSRecycleArray::release_chunk(chunk);
+        }
+        spdlog::trace("[{}] CSLSTimeShift::check_spilled, key={}, segment={:d}, size={:d}.",
+                      fmt::ptr(this), m_key, segment->id, segment->size);
+    }
+}
+
+//the segment is out of m_segments, a reader keeps its open file.
+void CSLSTimeShift::free_segment(SLSTimeShiftSegment *segment)
+{
+    for (SLSChunk *chunk : segment->chunks)
+    {
+        CSLSRecycleArray::release_chunk(chunk);
+    }
+    if (segment->spilled)
+    {
+        char filename[URL_MAX_LEN] = {0};
+        get_filename(segment->id, filename, sizeof(filename));
+        unlink(filename);
+    }
+    delete segment;
+}
+
+//the data written until the play time, readers get it at the pace it was written.
+int64_t CSLSTimeShift::get_readable(int index, int64_t play_time_ms)
+{
+    SLSTimeShiftSegment *segment = m_segments[index];
+    if (index + 1 < (int)m_segments.size() && m_segments[index + 1]->start_time_ms <= play_time_ms)
+    {
+        return segment->size;
+    }
+    int64_t readable = 0;
+    for (SLSTimeShiftCheckpoint &checkpoint : segment->checkpoints)
+    {
+        if (checkpoint.time_ms > play_time_ms)
+            break;
+        readable = checkpoint.size;
+    }
+    return readable;
+}
+
+int CSLSTimeShift::get(SLSChunkView *views, int &view_count, SLSTimeShiftID *read_id, int64_t cur_time_ms)
+{
+    int ret = 0;
+    int max_view_count = view_count;
+    view_count = 0;
+    int64_t play_time_ms = cur_time_ms - read_id->shift;
+
+    //a spilled segment is read after the lock is released, the publisher never waits for the disk.
+    int64_t file_segment_id = -1;
+    int64_t file_len = 0;
+    int64_t file_size = 0;
+    {
+        CSLSLock lock(&m_rwclock, false);
+        if (m_segments.empty())
+        {
+            return SLS_ERROR;
+        }
+        int64_t first_id = m_segments.front()->id;
+        if (read_id->segment_id < first_id)
+        {
+            if (read_id->segment_id >= 0)
+            {
+                read_id->overrun++;
+                spdlog::warn("[{}] CSLSTimeShift::get, key={}, segment={:d} is dropped, the oldest is {:d}.",
+                             fmt::ptr(this), m_key, read_id->segment_id, first_id);
+            }
+            //start from the last keyframe before the play time, or the oldest one kept.
+            int index = 0;
+            for (int i = 1; i < (int)m_segments.size() && m_segments[i]->start_time_ms <= play_time_ms; i++)
+            {
+                index = i;
+            }
+            read_id->segment_id = m_segments[index]->id;
+            read_id->pos = 0;
+            read_id->bFirst = true;
+        }
+
+        while (view_count < max_view_count)
+        {
+            int index = (int)(read_id->segment_id - first_id);
+            if (index >= (int)m_segments.size())
+            {
+                break;
+            }
+            SLSTimeShiftSegment *segment = m_segments[index];
+            int64_t readable = get_readable(index, play_time_ms);
+            if (read_id->pos >= readable)
+            {
+                //go on with the next segment once it is due.
+                if (read_id->pos >= segment->size && index + 1 < (int)m_segments.size() &&
+                    m_segments[index + 1]->start_time_ms <= play_time_ms)
+                {
+                    read_id->segment_id++;
+                    read_id->pos = 0;
+                    continue;
+                }
+                break;
+            }
+
+            if (segment->spilled)
+            {
+                file_segment_id = segment->id;
+                file_len = readable - read_id->pos;
+                file_size = segment->size;
+                break;
+            }
+            int len = read_memory(segment, read_id->pos, readable - read_id->pos, &views[view_count]);
+            if (len <= 0)
+            {
+                //skip the broken segment.
+                read_id->pos = segment->size;
+                continue;
+            }
+            read_id->pos += len;
+            ret += len;
+            view_count++;
+        }
+    }
+
+    if (file_segment_id >= 0)
+    {
+        //an open file stays readable when the segment is dropped meanwhile.
+        int len = read_file(file_segment_id, read_id, file_len, &views[view_count]);
+        if (len <= 0)
+        {
+            //skip the broken segment.
+            read_id->pos = file_size;
+            return ret;
+        }
+        read_id->pos += len;
+        ret += len;
+        view_count++;
+    }
+    return ret;
+}
+
+int CSLSTimeShift::read_memory(SLSTimeShiftSegment *segment, int64_t pos, int64_t len, SLSChunkView *view)
+{
+    //the last chunk which starts at or before pos.
+    auto it = std::upper_bound(segment->chunks.begin(), segment->chunks.end(), pos,
+                               [](int64_t p, SLSChunk *chunk)
+                               { return p < chunk->byte_seq.load(std::memory_order_relaxed); });
+    if (it == segment->chunks.begin())
+    {
+        return SLS_ERROR;
+    }
+    SLSChunk *chunk = *(it - 1);
+    int offset = (int)(pos - chunk->byte_seq.load(std::memory_order_relaxed));
+    int avail = chunk->len.load(std::memory_order_acquire) - offset;
+    if (avail <= 0)
+    {
+        return SLS_ERROR;
+    }
+    CSLSRecycleArray::add_ref_chunk(chunk);
+    view->chunk = chunk;
+    view->offset = offset;
+    view->len = len < avail ? (int)len : avail;
+    return view->len;
+}
+
+//read the spilled data into a new chunk, whole messages or ts packets only.
+int CSLSTimeShift::read_file(int64_t segment_id, SLSTimeShiftID *read_id, int64_t len, SLSChunkView *view)
+{
+    if (read_id->fd_segment_id != segment_id)
+    {
+        close_id(read_id);
+        char filename[URL_MAX_LEN] = {0};
+        get_filename(segment_id, filename, sizeof(filename));
+        read_id->fd = ::open(filename, O_RDONLY);
+        if (read_id->fd < 0)
+        {
+            spdlog::error("[{}] CSLSTimeShift::read_file, key={}, open '{}' failed, errno={:d}.",
+                          fmt::ptr(this), m_key, filename, errno);
+            return SLS_ERROR;
+        }
+        read_id->fd_segment_id = segment_id;
+    }
+
+    SLSChunk *chunk = CSLSRecycleArray::alloc_chunk(SLS_CHUNK_SIZE);
+    chunk->seq.store(-1, std::memory_order_relaxed);
+    chunk->ring_id.store(0, std::memory_order_relaxed);
+    int n = (int)pread(read_id->fd, chunk->data, len < chunk->capacity ? len : chunk->capacity, read_id->pos);
+    if (m_message_mode)
+    {
+        int pos = 0;
+        while (pos + SLS_MSG_HEADER_LEN <= n && pos + SLS_MSG_HEADER_LEN + sls_get_msg_len(chunk->data + pos) <= n)
+        {
+            pos += SLS_MSG_HEADER_LEN + sls_get_msg_len(chunk->data + pos);
+        }
+        n = pos;
+    }
+    else if (n >= TS_PACK_LEN)
+    {
+        n -= n % TS_PACK_LEN;
+    }
+    if (n <= 0)
+    {
+        spdlog::error("[{}] CSLSTimeShift::read_file, key={}, segment={:d}, read failed, pos={:d}, errno={:d}.",
+                      fmt::ptr(this), m_key, segment_id, read_id->pos, errno);
+        CSLSRecycleArray::release_chunk(chunk);
+        return SLS_ERROR;
+    }
+    chunk->len = n;
+    view->chunk = chunk;
+    view->offset = 0;
+    view->len = n;
+    return n;
+}
+
+void CSLSTimeShift::get_filename(int64_t id, char *filename, int len)
+{
+    snprintf(filename, len, "%s/%lld.ts", m_path.c_str(), (long long)id);
+}
@@ -0,0 +1,181 @@
+
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Edward.Wu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common.hpp"
+#include "SLSLock.hpp"
+#include "SLSRecycleArray.hpp"
+#include "SLSThread.hpp"
+
+const int SLS_TIMESHIFT_SEGMENT_DURATION = 2000; //ms, a segment is closed at the next keyframe after it
+const int SLS_TIMESHIFT_CHECKPOINT_INTERVAL = 100; //ms, players are paced by the checkpoints
+
+/**
+ * SLSTimeShiftConf, per stream time shift settings from the app conf.
+ */
+struct SLSTimeShiftConf
+{
+    int duration; //ms kept for players joining with an offset, 0: off
+    int memory;   //ms kept in memory, older segments are spilled to path
+    char path[URL_MAX_LEN];
+};
+
+/**
+ * SLSTimeShiftID, the read position of a time shifted player.
+ */
+struct SLSTimeShiftID
+{
+    int64_t shift;      //ms behind the live stream, 0: live
+    int64_t segment_id; //-1 before the first read
+    int64_t pos;        //next byte in the segment
+    int64_t overrun;    //times the segment was dropped under the reader
+    bool bFirst;        //a keyframe is next, sps and pps go first
+    int fd;             //the spilled segment being read
+    int64_t fd_segment_id;
+};
+
+/**
+ * SLSTimeShiftCheckpoint, the segment size at a time.
+ */
+struct SLSTimeShiftCheckpoint
+{
+    int64_t time_ms;
+    int64_t size;
+};
+
+/**
+ * SLSTimeShiftSegment, the data from one keyframe to the next segment,
+ * kept in chunks in memory and later in a file.
+ */
+struct SLSTimeShiftSegment
+{
+    int64_t id;
+    int64_t start_time_ms;
+    int64_t size;    //readable, published with the checkpoints
+    int64_t written; //only touched by the publisher
+    bool spilled;
+    bool spilling;   //queued to the spill thread, only touched by the publisher
+    std::vector<SLSChunk *> chunks; //chunk->byte_seq is the segment pos of its data
+    std::vector<SLSTimeShiftCheckpoint> checkpoints;
+};
+
+class CSLSTimeShift;
+
+/**
+ * SLSTimeShiftSpill, a closed segment to be written to its file,
+ * the job keeps its own references of the chunks.
+ */
+struct SLSTimeShiftSpill
+{
+    CSLSTimeShift *owner;
+    int64_t segment_id;
+    std::string filename;
+    std::vector<SLSChunk *> chunks;
+};
+
+/**
+ * CSLSTimeShiftSpiller
+ * one thread which writes the closed segments of all streams to disk,
+ * so neither the publishers nor the players wait for the files.
+ */
+class CSLSTimeShiftSpiller : public CSLSThread
+{
+public:
+    static CSLSTimeShiftSpiller *get_instance();
+
+    CSLSTimeShiftSpiller();
+    ~CSLSTimeShiftSpiller();
+
+    void push(SLSTimeShiftSpill &job);
+    void cancel(CSLSTimeShift *owner);
+
+    virtual int work();
+
+private:
+    std::deque<SLSTimeShiftSpill> m_jobs;
+    CSLSTimeShift *m_running_owner; //the owner of the job being written
+    bool m_started;
+    CSLSMutex m_mutex;
+    pthread_cond_t m_cond;
+
+    int spill(SLSTimeShiftSpill &job);
+};
+
+/**
+ * CSLSTimeShift
+ * the recent data of a stream for players joining behind the live edge,
+ * split into segments at keyframes, the start times of the segments are
+ * the keyframe index. only the publisher writes, players read the data
+ * back at the pace it was written. the closed segments out of the memory
+ * tier are written to files by CSLSTimeShiftSpiller.
+ */
+class CSLSTimeShift
+{
+public:
+    CSLSTimeShift(const char *key, const SLSTimeShiftConf *conf, bool message_mode);
+    ~CSLSTimeShift();
+
+    int write(const char *data, int len, int keyframe_pos, int64_t cur_time_ms);
+    int get(SLSChunkView *views, int &view_count, SLSTimeShiftID *read_id, int64_t cur_time_ms);
+
+    static void init_id(SLSTimeShiftID *read_id, int64_t shift);
+    static void close_id(SLSTimeShiftID *read_id);
+
+    void on_spilled(int64_t segment_id, bool ok);
+
+private:
+    std::string m_key;
+    std::string m_path; //empty: memory only
+    int m_duration;
+    int m_memory;
+    bool m_message_mode;
+    int64_t m_next_id;
+    int64_t m_last_check_time;
+
+    std::deque<SLSTimeShiftSegment *> m_segments;
+    CSLSRWLock m_rwclock;
+
+    //the segments written by the spill thread, applied by the publisher.
+    std::vector<std::pair<int64_t, bool>> m_spilled;
+    std::atomic<bool> m_spilled_pending;
+    CSLSMutex m_spilled_mutex;
+
+    void append(SLSTimeShiftSegment *segment, const char *data, int len);
+    void add_checkpoint(SLSTimeShiftSegment *segment, int64_t cur_time_ms);
+    void check_segments(int64_t cur_time_ms);
+    void spill(SLSTimeShiftSegment *segment);
+    void check_spilled();
+    void free_segment(SLSTimeShiftSegment *segment);
+    int64_t get_readable(int index, int64_t play_time_ms);
+    int read_memory(SLSTimeShiftSegment *segment, int64_t pos, int64_t len, SLSChunkView *view);
+    int read_file(int64_t segment_id, SLSTimeShiftID *read_id, int64_t len, SLSChunkView *view);
+    void get_filename(int64_t id, char *filename, int len);
+};
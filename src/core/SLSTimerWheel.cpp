@@ -0,0 +1,130 @@
+
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Edward.Wu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stddef.h>
+
+#include "SLSTimerWheel.hpp"
+#include "common.hpp"
+
+/**
+ * CSLSTimerWheel class implementation
+ */
+
+CSLSTimerWheel::CSLSTimerWheel()
+{
+    m_cur_tick = sls_gettime_ms() / SLS_TIMER_TICK;
+    m_size = 0;
+}
+
+CSLSTimerWheel::~CSLSTimerWheel()
+{
+}
+
+void CSLSTimerWheel::add(int64_t expire_ms, int type, int id, void *data)
+{
+    SLSTimer timer = {expire_ms, type, id, data};
+    place(timer);
+    m_size++;
+}
+
+//put the timer in the slot of its tick, relative to the next tick to expire.
+void CSLSTimerWheel::place(const SLSTimer &timer)
+{
+    //rounded up, a timer never fires early.
+    int64_t tick = (timer.expire_ms + SLS_TIMER_TICK - 1) / SLS_TIMER_TICK;
+    int64_t delta = tick - m_cur_tick;
+    if (delta < 0)
+    {
+        //due already, expired by the next call.
+        tick = m_cur_tick;
+        delta = 0;
+    }
+    if (delta < (1 << SLS_TIMER_ROOT_BITS))
+    {
+        m_root[tick & ((1 << SLS_TIMER_ROOT_BITS) - 1)].push_back(timer);
+        return;
+    }
+    int shift = SLS_TIMER_ROOT_BITS;
+    for (int level = 0; level < SLS_TIMER_LEVELS - 1; level++)
+    {
+        shift += SLS_TIMER_LEVEL_BITS;
+        if (delta < ((int64_t)1 << shift) || level == SLS_TIMER_LEVELS - 2)
+        {
+            if (delta >= ((int64_t)1 << shift))
+            {
+                //beyond the wheel, placed again when the last slot comes up.
+                tick = m_cur_tick + ((int64_t)1 << shift) - 1;
+            }
+            int index = (tick >> (shift - SLS_TIMER_LEVEL_BITS)) & ((1 << SLS_TIMER_LEVEL_BITS) - 1);
+            m_levels[level][index].push_back(timer);
+            return;
+        }
+    }
+}
+
+//move the timers of the slot down, return the slot index.
+int CSLSTimerWheel::cascade(int level, int index)
+{
+    std::vector<SLSTimer> timers;
+    timers.swap(m_levels[level][index]);
+    for (const SLSTimer &timer : timers)
+    {
+        place(timer);
+    }
+    return index;
+}
+
+//append the timers due by cur_time_ms, return their count.
+int CSLSTimerWheel::expire(int64_t cur_time_ms, std::vector<SLSTimer> &timers)
+{
+    int64_t target = cur_time_ms / SLS_TIMER_TICK;
+    int count = 0;
+    while (m_cur_tick <= target)
+    {
+        int index = m_cur_tick & ((1 << SLS_TIMER_ROOT_BITS) - 1);
+        if (0 == index)
+        {
+            int shift = SLS_TIMER_ROOT_BITS;
+            for (int level = 0; level < SLS_TIMER_LEVELS - 1; level++)
+            {
+                int level_index = (m_cur_tick >> shift) & ((1 << SLS_TIMER_LEVEL_BITS) - 1);
+                if (0 != cascade(level, level_index))
+                    break;
+                shift += SLS_TIMER_LEVEL_BITS;
+            }
+        }
+        std::vector<SLSTimer> &slot = m_root[index];
+        timers.insert(timers.end(), slot.begin(), slot.end());
+        count += slot.size();
+        slot.clear();
+        m_cur_tick++;
+    }
+    m_size -= count;
+    return count;
+}
+
+int CSLSTimerWheel::size()
+{
+    return m_size;
+}
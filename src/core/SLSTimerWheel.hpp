@@ -0,0 +1,69 @@
+
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Edward.Wu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+const int SLS_TIMER_TICK = 10;        //ms
+const int SLS_TIMER_ROOT_BITS = 8;    //slots of the first level
+const int SLS_TIMER_LEVEL_BITS = 6;   //slots of each higher level
+const int SLS_TIMER_LEVELS = 3;       //about 2.9 hours, later timers wait in the last slot
+
+struct SLSTimer
+{
+    int64_t expire_ms;
+    int type;   //defined by the owner
+    int id;
+    void *data;
+};
+
+/**
+ * CSLSTimerWheel
+ * hierarchical timing wheel of one thread, adding a timer and expiring
+ * the due ones cost O(1) each, timers of the higher levels are moved down
+ * once their range comes up. there is no cancel, the owner ignores a fired
+ * timer which is no longer current.
+ */
+class CSLSTimerWheel
+{
+public:
+    CSLSTimerWheel();
+    ~CSLSTimerWheel();
+
+    void add(int64_t expire_ms, int type, int id, void *data = NULL);
+    int expire(int64_t cur_time_ms, std::vector<SLSTimer> &timers);
+    int size();
+
+private:
+    std::vector<SLSTimer> m_root[1 << SLS_TIMER_ROOT_BITS];
+    std::vector<SLSTimer> m_levels[SLS_TIMER_LEVELS - 1][1 << SLS_TIMER_LEVEL_BITS];
+    int64_t m_cur_tick;       //the next tick to expire
+    int m_size;
+
+    void place(const SLSTimer &timer);
+    int cascade(int level, int index);
+};
@@ -358,6 +358,73 @@ void sls_remove_marks(char *s)
     }
 }
 
+//'30', '-30s', '1500ms' or '2m', the sign is ignored, return ms or -1 if invalid.
+int64_t sls_parse_duration_ms(const char *s)
+{
+    char *end = NULL;
+    long long value = strtoll(s, &end, 10);
+    if (end == s)
+        return -1;
+    if (value < 0)
+        value = -value;
+    if (*end == '\0' || strcmp(end, "s") == 0)
+        return value * 1000;
+    if (strcmp(end, "ms") == 0)
+        return value;
+    if (strcmp(end, "m") == 0)
+        return value * 60 * 1000;
+    return -1;
+}
+
+//'0-3,8,10-11', return the count of the cpus or -1 if invalid.
+int sls_parse_cpu_list(const char *s, std::vector<int> &cpus)
+{
+    cpus.clear();
+    std::vector<std::string> ranges;
+    sls_split_string(s, ",", ranges);
+    for (std::string &range : ranges)
+    {
+        if (range.empty())
+            continue;
+        char *end = NULL;
+        long first = strtol(range.c_str(), &end, 10);
+        long last = first;
+        if (end == range.c_str() || first < 0)
+            return -1;
+        if (*end == '-')
+        {
+            const char *p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first)
+                return -1;
+        }
+        if (*end != '\0')
+            return -1;
+        for (long cpu = first; cpu <= last; cpu++)
+            cpus.push_back((int)cpu);
+    }
+    return cpus.size();
+}
+
+//the numa node of the cpu from sysfs, -1 if unknown.
+int sls_get_cpu_node(int cpu)
+{
+    char path[URL_MAX_LEN];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    int node = -1;
+    std::error_code ec;
+    for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(path, ec))
+    {
+        std::string name = entry.path().filename().string();
+        if (name.compare(0, 4, "node") == 0 && name.size() > 4 && isdigit(name[4]))
+        {
+            node = atoi(name.c_str() + 4);
+            break;
+        }
+    }
+    return node;
+}
+
 int sls_read_pid()
 {
     struct stat stat_file;
@@ -616,6 +683,13 @@ enum
     H264_NAL_AUD = 9,
 };
 
+enum
+{
+    HEVC_NAL_BLA_W_LP = 16,
+    HEVC_NAL_CRA_NUT = 21,
+    HEVC_NAL_VPS = 32,
+};
+
 static int64_t ff_parse_pes_pts(const uint8_t *buf)
 {
 
@@ -893,6 +967,35 @@ static int sls_parse_pat(const uint8_t *pat_data, int len, ts_info *ti)
     return SLS_OK;
 }
 
+static int sls_parse_pmt(const uint8_t *pmt_data, int len, ts_info *ti)
+{
+    const uint8_t *buffer = pmt_data;
+    if (len < 12 || buffer[0] != 0x02)
+    {
+        return SLS_ERROR;
+    }
+    int section_length = (buffer[1] & 0x0F) << 8 | buffer[2];
+    int program_info_length = (buffer[10] & 0x0F) << 8 | buffer[11];
+    int end = 3 + section_length - 4; // without crc
+    if (end > len)
+        end = len;
+
+    for (int n = 12 + program_info_length; n + 5 <= end;)
+    {
+        int stream_type = buffer[n];
+        int pid = (buffer[n + 1] & 0x1F) << 8 | buffer[n + 2];
+        int es_info_length = (buffer[n + 3] & 0x0F) << 8 | buffer[n + 4];
+        if (STREAM_TYPE_VIDEO_H264 == stream_type || STREAM_TYPE_VIDEO_HEVC == stream_type)
+        {
+            ti->video_pid = pid;
+            ti->video_stream_type = stream_type;
+            return SLS_OK;
+        }
+        n += 5 + es_info_length;
+    }
+    return SLS_ERROR;
+}
+
 int sls_parse_ts_info(const uint8_t *packet, ts_info *ti)
 {
 
@@ -922,6 +1025,15 @@ int sls_parse_ts_info(const uint8_t *packet, ts_info *ti)
         {
             memcpy(ti->pmt, packet, TS_PACK_LEN);
             ti->pmt_len = TS_PACK_LEN;
+            int pos = 4;
+            if (packet[3] & 0x20)
+                pos += packet[4] + 1;
+            if (pos < TS_PACK_LEN - 1)
+            {
+                pos += packet[pos] + 1; // pointer field
+                if (pos < TS_PACK_LEN)
+                    sls_parse_pmt(packet + pos, TS_PACK_LEN - pos, ti);
+            }
             return SLS_OK;
         }
         if (INVALID_PID != ti->es_pid)
@@ -1000,6 +1112,8 @@ void sls_init_ts_info(ts_info *ti)
         ti->pmt_len = 0;
         ti->pmt_pid = INVALID_PID;
         ti->need_spspps = false;
+        ti->video_pid = INVALID_PID;
+        ti->video_stream_type = 0;
 
         memset(ti->ts_data, 0, TS_UDP_LEN);
 
@@ -1013,3 +1127,130 @@ void sls_init_ts_info(ts_info *ti)
         }
     }
 }
+
+static bool sls_is_keyframe_nal(const uint8_t *es, int es_len, int stream_type)
+{
+    for (int pos = 0; pos + 3 < es_len; pos++)
+    {
+        if (0x0 != es[pos] || 0x0 != es[pos + 1] || 0x1 != es[pos + 2])
+        {
+            continue;
+        }
+        uint8_t nal = es[pos + 3];
+        if (STREAM_TYPE_VIDEO_HEVC == stream_type)
+        {
+            int nal_type = (nal >> 1) & 0x3f;
+            if ((nal_type >= HEVC_NAL_BLA_W_LP && nal_type <= HEVC_NAL_CRA_NUT) || HEVC_NAL_VPS == nal_type)
+                return true;
+        }
+        else
+        {
+            int nal_type = nal & 0x1f;
+            if (H264_NAL_IDR_SLICE == nal_type || H264_NAL_SPS == nal_type)
+                return true;
+        }
+        pos += 3;
+    }
+    return false;
+}
+
+/*
+ * find the ts packet which starts a keyframe of the video pid,
+ * return the offset in data, or -1 if there isn't.
+ */
+int sls_find_keyframe(const uint8_t *data, int len, ts_info *ti)
+{
+    if (INVALID_PID == ti->video_pid)
+    {
+        return -1;
+    }
+    for (int i = 0; i + TS_PACK_LEN <= len; i += TS_PACK_LEN)
+    {
+        const uint8_t *packet = data + i;
+        if (packet[0] != TS_SYNC_BYTE || 0 == (packet[1] & 0x40))
+        {
+            continue;
+        }
+        int pid = (int)((packet[1] & 0x1F) << 8) | (packet[2] & 0xFF);
+        if (pid != ti->video_pid)
+        {
+            continue;
+        }
+        int pos = 4;
+        if (packet[3] & 0x20)
+        {
+            // random_access_indicator
+            if (packet[4] > 0 && (packet[5] & 0x40))
+            {
+                return i;
+            }
+            pos += packet[4] + 1;
+        }
+        // skip the pes header
+        if (0 == (packet[3] & 0x10) || pos + 9 >= TS_PACK_LEN)
+        {
+            continue;
+        }
+        pos += 9 + packet[pos + 8];
+        if (pos < TS_PACK_LEN && sls_is_keyframe_nal(packet + pos, TS_PACK_LEN - pos, ti->video_stream_type))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * set the discontinuity_indicator of the first packet with an adaptation field
+ * of each pid which is not in marked_pids yet, the marked pids are appended.
+ * return the count of the marked packets.
+ */
+int sls_set_ts_discontinuity(uint8_t *data, int len, std::vector<int> &marked_pids)
+{
+    int count = 0;
+    for (int i = 0; i + TS_PACK_LEN <= len; i += TS_PACK_LEN)
+    {
+        uint8_t *packet = data + i;
+        if (packet[0] != TS_SYNC_BYTE || 0 == (packet[3] & 0x20) || 0 == packet[4])
+        {
+            continue;
+        }
+        int pid = (int)((packet[1] & 0x1F) << 8) | (packet[2] & 0xFF);
+        if (std::find(marked_pids.begin(), marked_pids.end(), pid) != marked_pids.end())
+        {
+            continue;
+        }
+        packet[5] |= 0x80;
+        marked_pids.push_back(pid);
+        count++;
+    }
+    return count;
+}
+
+/*
+ * keep the continuity counters of each pid continuous when the data comes
+ * from another publisher, last_cc is the last counter of each pid and cc_offset
+ * the shift of the current publisher, both have TS_PID_COUNT items, -1 is unknown.
+ */
+void sls_fix_ts_cc(uint8_t *data, int len, int8_t *last_cc, int8_t *cc_offset)
+{
+    for (int i = 0; i + TS_PACK_LEN <= len; i += TS_PACK_LEN)
+    {
+        uint8_t *packet = data + i;
+        if (packet[0] != TS_SYNC_BYTE)
+        {
+            continue;
+        }
+        int pid = (int)((packet[1] & 0x1F) << 8) | (packet[2] & 0xFF);
+        int cc = packet[3] & 0x0F;
+        if (cc_offset[pid] < 0)
+        {
+            // the counter only increases with a payload
+            int next_cc = (packet[3] & 0x10) ? last_cc[pid] + 1 : last_cc[pid];
+            cc_offset[pid] = last_cc[pid] < 0 ? 0 : (next_cc - cc) & 0x0F;
+        }
+        cc = (cc + cc_offset[pid]) & 0x0F;
+        packet[3] = (packet[3] & 0xF0) | cc;
+        last_cc[pid] = cc;
+    }
+}
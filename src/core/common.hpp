@@ -85,6 +85,7 @@ using namespace std;
 
 #define TS_PACK_LEN 188
 #define TS_UDP_LEN 1316 // 7*188
+#define SRT_LIVE_MAX_PAYLOAD_LEN 1456 // max payload of a srt live message
 #define SHORT_STR_MAX_LEN 256
 #define STR_MAX_LEN 2048
 #define HOST_MAX_LEN 256
@@ -101,6 +102,9 @@ void sls_gettime_default_string(char *cur_time_buf, size_t cur_time_buf_len);
 char *sls_strupper(char *str);
 char *sls_strlower(char *str);
 void sls_remove_marks(char *s);
+int64_t sls_parse_duration_ms(const char *s);
+int sls_parse_cpu_list(const char *s, std::vector<int> &cpus);
+int sls_get_cpu_node(int cpu);
 
 uint32_t sls_hash_key(const char *data, size_t len);
 int sls_gethostbyname(const char *hostname, char *ip);
@@ -128,6 +132,7 @@ struct stat_info_t
     int remote_port;
     std::string start_time;
     int kbitrate;
+    int64_t overruns;
 };
 
 /*
@@ -137,9 +142,12 @@ struct stat_info_t
 #define TS_SYNC_BYTE 0x47
 #define TS_PACK_LEN 188
 #define INVALID_PID -1
+#define TS_PID_COUNT 8192
 #define PAT_PID 0
 #define INVALID_DTS_PTS -1
 #define MAX_PES_PAYLOAD 200 * 1024
+#define STREAM_TYPE_VIDEO_H264 0x1B
+#define STREAM_TYPE_VIDEO_HEVC 0x24
 
 struct ts_info
 {
@@ -157,6 +165,11 @@ struct ts_info
     int pmt_pid;
     uint8_t pmt[TS_PACK_LEN];
     int pmt_len;
+    int video_pid;
+    int video_stream_type;
 };
 void sls_init_ts_info(ts_info *ti);
 int sls_parse_ts_info(const uint8_t *packet, ts_info *ti);
+int sls_find_keyframe(const uint8_t *data, int len, ts_info *ti);
+int sls_set_ts_discontinuity(uint8_t *data, int len, std::vector<int> &marked_pids);
+void sls_fix_ts_cc(uint8_t *data, int len, int8_t *last_cc, int8_t *cc_offset);
@@ -293,6 +293,8 @@ int main(int argc, char *argv[])
         {
             ret = sls_manager->single_thread_handler();
         }
+        sls_manager->check_held_streams(cur_tm_ms);
+        sls_manager->check_balance(cur_tm_ms);
         if (NULL != http_stat_client)
         {
             if (!http_stat_client->is_valid())
@@ -311,7 +313,11 @@ int main(int argc, char *argv[])
             }
         }
 
-        msleep(10);
+        // the single thread waits in the group handler
+        if (!sls_manager->is_single_thread())
+        {
+            msleep(10);
+        }
 
         /*for test reload...
         int64_t tm_cur = sls_gettime();
@@ -325,16 +331,23 @@ int main(int argc, char *argv[])
 
         // Check reloaded manager
         std::vector<CSLSManager *>::iterator it;
-        for (it = reload_manager_list.begin(); it != reload_manager_list.end(); it++)
+        for (it = reload_manager_list.begin(); it != reload_manager_list.end();)
         {
             CSLSManager *manager = *it;
+            if (nullptr != manager)
+            {
+                // its held streams still expire, so their players can leave
+                manager->check_held_streams(cur_tm_ms);
+            }
             if (nullptr != manager && SLS_OK == manager->check_invalid())
             {
                 spdlog::info("Checking reloaded manager, deleting manager={:p} ...", fmt::ptr(manager));
                 manager->stop();
-                reload_manager_list.erase(it);
+                it = reload_manager_list.erase(it);
                 delete manager;
+                continue;
             }
+            it++;
         }
 
         if (b_reload)